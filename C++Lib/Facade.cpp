@@ -17,14 +17,14 @@ class Customer{
 private:
     string name;
 public:
-    string getName() {return name;}
+    const string &getName() const {return name;}
     explicit Customer(string customer_name) {name = move(customer_name);}
 };
 
 // Subsystem Class 1. "Bank"
 class Bank{
 public:
-    bool HasSufficientSavings(Customer customer, int amount){
+    bool HasSufficientSavings(const Customer &customer, int amount){
         cout << "Check bank balance of " << customer.getName()
                         << " for the amount " << amount << endl;
         return true;
@@ -34,7 +34,7 @@ public:
 // Subsystem Class 2. "Credit"
 class Credit{
 public:
-    bool HasGoodCredit(Customer customer) {
+    bool HasGoodCredit(const Customer &customer) {
         cout << "Check credit for " << customer.getName() << endl;
         return true;
     }
@@ -44,7 +44,7 @@ public:
 
 class Loan {
 public:
-    bool HasNoBadLoans(Customer customer) {
+    bool HasNoBadLoans(const Customer &customer) {
         cout << "Check outstanding loans for " << customer.getName() << endl;
         return true;
     }
@@ -63,7 +63,7 @@ public:
         credit = new Credit();
     }
 
-    bool isEligible(Customer customer, int amount) {
+    bool isEligible(const Customer &customer, int amount) {
         cout << customer.getName() << " applies for " << amount << "TL loan" << endl;
         bool eligible = true;
 
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : FacadeAsync.cpp
+//
+//Concurrent variant of Facade.cpp. In production every subsystem check is a
+//slow remote lookup, so the sequential facade pays the sum of the three
+//latencies. The async facade pays roughly the slowest one:
+//1. Facade   (Mortgage)
+//		- isEligible(customer, amount) is the original sequential check.
+//		- isEligibleAsync(customer, amount) starts the Bank, Loan and Credit
+//		  checks on their own threads and returns as soon as one of them
+//		  fails (cancelling the others) or all of them pass. A check that
+//		  does not answer within its subsystem's timeout counts as a failure.
+//2. Subsystem classes   (Bank, Credit, Loan)
+//		- local stand-ins for the remote lookups. Each one waits for a
+//		  simulated latency before answering and gives up early when its
+//		  stop_token is signalled.
+//============================================================================
+
+using Clock = chrono::steady_clock;
+using Millis = chrono::duration<double, milli>;
+
+// When false, the facade does not narrate its checks. The latency harness
+// turns it off so that cout does not end up in the measurements.
+static bool verbose = true;
+
+// Client Class "Customer"
+class Customer{
+private:
+    string name;
+    int savings;
+    int badLoans;
+    int creditScore;
+public:
+    Customer(string customer_name, int customer_savings, int bad_loans, int credit_score) {
+        name = move(customer_name);
+        savings = customer_savings;
+        badLoans = bad_loans;
+        creditScore = credit_score;
+    }
+    const string &getName() const {return name;}
+    int getSavings() const {return savings;}
+    int getBadLoans() const {return badLoans;}
+    int getCreditScore() const {return creditScore;}
+};
+
+// Simulated remote round trip. Latencies are log-normal around `median`,
+// so a few requests are much slower than the rest, like real backends.
+// Returns false if the wait was cancelled through the stop_token.
+class RemoteLatency{
+public:
+    explicit RemoteLatency(Millis median) : _median(median), _gen(random_device{}()) {}
+
+    bool wait(const stop_token &token) {
+        Millis delay;
+        {
+            lock_guard<mutex> guard(_lock);
+            delay = _median * _spread(_gen);
+        }
+        mutex m;
+        condition_variable_any cv;
+        unique_lock<mutex> lock(m);
+        // Only a stop request can wake us up early.
+        cv.wait_for(lock, token, delay, [] {return false;});
+        return !token.stop_requested();
+    }
+
+private:
+    Millis _median;
+    mt19937 _gen;
+    lognormal_distribution<double> _spread{0.0, 0.5};
+    mutex _lock;
+};
+
+// Subsystem Class 1. "Bank"
+class Bank{
+public:
+    explicit Bank(Millis latency) : remote(latency) {}
+    bool HasSufficientSavings(const Customer &customer, int amount, const stop_token &token = {}){
+        if (!remote.wait(token)) return false;
+        return customer.getSavings() >= amount / 5; // 20% down payment
+    }
+private:
+    RemoteLatency remote;
+};
+
+// Subsystem Class 2. "Credit"
+class Credit{
+public:
+    explicit Credit(Millis latency) : remote(latency) {}
+    bool HasGoodCredit(const Customer &customer, const stop_token &token = {}) {
+        if (!remote.wait(token)) return false;
+        return customer.getCreditScore() > 650;
+    }
+private:
+    RemoteLatency remote;
+};
+
+// Subsystem Class 3. "Loan"
+class Loan {
+public:
+    explicit Loan(Millis latency) : remote(latency) {}
+    bool HasNoBadLoans(const Customer &customer, const stop_token &token = {}) {
+        if (!remote.wait(token)) return false;
+        return customer.getBadLoans() == 0;
+    }
+private:
+    RemoteLatency remote;
+};
+
+// How long the async facade waits for each subsystem before giving up.
+struct Timeouts{
+    Millis bank{100};
+    Millis loan{100};
+    Millis credit{100};
+};
+
+// Facade "Mortgage"
+class Mortgage{
+private:
+    Bank *bank;
+    Loan *loan;
+    Credit *credit;
+    Timeouts timeouts;
+public:
+    Mortgage(Bank *b, Loan *l, Credit *c, Timeouts t = {}) {
+        bank = b;
+        loan = l;
+        credit = c;
+        timeouts = t;
+    }
+
+    bool isEligible(const Customer &customer, int amount) {
+        if (verbose)
+            cout << customer.getName() << " applies for " << amount << "TL loan" << endl;
+        bool eligible = true;
+
+        //Check applicant creditworthiness
+        if (!bank->HasSufficientSavings(customer, amount)){
+            eligible = false;
+        }
+        else if (!loan->HasNoBadLoans(customer)) {
+            eligible = false;
+        }
+        else if (!credit->HasGoodCredit(customer)) {
+            eligible = false;
+        }
+        return eligible;
+    }
+
+    bool isEligibleAsync(const Customer &customer, int amount) {
+        if (verbose)
+            cout << customer.getName() << " applies for " << amount << "TL loan (async)" << endl;
+
+        enum Answer {Pending, Passed, Failed};
+        mutex m;
+        condition_variable done;
+        Answer answers[3] = {Pending, Pending, Pending};
+        stop_source cancel;
+
+        // Each check reports to answers[slot] and wakes the facade up.
+        auto report = [&](int slot, bool ok) {
+            {
+                lock_guard<mutex> guard(m);
+                answers[slot] = ok ? Passed : Failed;
+            }
+            done.notify_one();
+        };
+
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadlines[3] = {
+            start + chrono::duration_cast<Clock::duration>(timeouts.bank),
+            start + chrono::duration_cast<Clock::duration>(timeouts.loan),
+            start + chrono::duration_cast<Clock::duration>(timeouts.credit)};
+        const char *names[3] = {"bank", "loan", "credit"};
+
+        // The checks are joined when this scope ends; by then they have
+        // either answered or been asked to stop.
+        bool eligible = true;
+        {
+            stop_token token = cancel.get_token();
+            jthread checks[3] = {
+                jthread([&] {report(0, bank->HasSufficientSavings(customer, amount, token));}),
+                jthread([&] {report(1, loan->HasNoBadLoans(customer, token));}),
+                jthread([&] {report(2, credit->HasGoodCredit(customer, token));})};
+
+            unique_lock<mutex> lock(m);
+            while (true) {
+                int passed = 0;
+                Clock::time_point next = Clock::time_point::max();
+                for (int i = 0; i < 3; i++) {
+                    if (answers[i] == Pending && Clock::now() >= deadlines[i]) {
+                        answers[i] = Failed;
+                        if (verbose) cout << "Timed out waiting for the " << names[i] << " check" << endl;
+                    }
+                    if (answers[i] == Failed) eligible = false;
+                    if (answers[i] == Passed) passed++;
+                    if (answers[i] == Pending) next = min(next, deadlines[i]);
+                }
+                if (!eligible || passed == 3) break;
+                done.wait_until(lock, next);
+            }
+            lock.unlock();
+            cancel.request_stop();
+        }
+        return eligible;
+    }
+};
+
+// Percentile of an already sorted sample.
+double percentile(const vector<double> &sorted, double p) {
+    size_t idx = min(sorted.size() - 1, (size_t) (p * (double) sorted.size()));
+    return sorted[idx];
+}
+
+void report(const string &name, vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    cout << name << " p50 " << percentile(samples, 0.50) << " ms, p99 "
+         << percentile(samples, 0.99) << " ms" << endl;
+}
+
+int main(int argc, char *argv[]){
+// Stand-ins for the remote subsystems: medians of 10, 15 and 20 ms.
+Bank *bank = new Bank(Millis(10));
+Loan *loan = new Loan(Millis(15));
+Credit *credit = new Credit(Millis(20));
+
+Timeouts timeouts;
+timeouts.credit = Millis(60); // the credit bureau is allowed to be slow, but not too slow
+Mortgage *mortgage = new Mortgage(bank, loan, credit, timeouts);
+
+// Evaluate mortgage eligibility for customer
+Customer *customer = new Customer("Ufuk Celikkan", 40000, 0, 720);
+bool eligible = mortgage->isEligibleAsync(*customer, 100000);
+cout << customer->getName() << " has been "
+                << (eligible ? "approved." : "rejected.") << endl;
+
+// Latency harness: the same applicants through both facades.
+int count = argc > 1 ? stoi(argv[1]) : 200;
+cout << endl << "Running " << count << " applications through each facade..." << endl;
+verbose = false;
+mt19937 gen(7);
+uniform_int_distribution<> savings(0, 100000);
+uniform_int_distribution<> badLoans(0, 9);
+uniform_int_distribution<> score(300, 850);
+vector<Customer> customers;
+for (int i = 0; i < count; i++)
+    customers.emplace_back("C" + to_string(i), savings(gen), badLoans(gen) == 0 ? 1 : 0, score(gen));
+
+vector<double> sequential, concurrent;
+int approvedSequential = 0, approvedConcurrent = 0;
+for (const Customer &c : customers) {
+    Clock::time_point start = Clock::now();
+    approvedSequential += mortgage->isEligible(c, 100000);
+    Clock::time_point middle = Clock::now();
+    approvedConcurrent += mortgage->isEligibleAsync(c, 100000);
+    Clock::time_point end = Clock::now();
+    sequential.push_back(Millis(middle - start).count());
+    concurrent.push_back(Millis(end - middle).count());
+}
+report("sequential facade:", sequential);
+report("async facade     :", concurrent);
+cout << "approved: " << approvedSequential << " sequential, " << approvedConcurrent
+     << " async (async may reject more because of timeouts)" << endl;
+}
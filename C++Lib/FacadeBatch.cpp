@@ -0,0 +1,264 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : FacadeBatch.cpp
+//
+//Batch variant of Facade.cpp. The facade still hides the subsystems, but
+//instead of evaluating one Customer at a time it evaluates a whole span of
+//applications:
+//1. Facade   (Mortgage)
+//		- isEligible(customer, amount) is the original one-at-a-time check.
+//		- isEligible(applications) copies the checked fields into columns
+//		  (ApplicationBatch) and runs each subsystem over the whole batch,
+//		  stage by stage, in the same order (Bank -> Loan -> Credit).
+//2. Subsystem classes   (Bank, Credit, Loan)
+//		- each offers a batch check that takes a selection vector (the
+//		  indices of the applications still alive) and narrows it in place.
+//		  An application rejected by Bank is never looked at by Loan, which
+//		  keeps the short-circuit semantics of the single check.
+//============================================================================
+
+// When false, the subsystems do not narrate their checks. The benchmark
+// turns it off so that cout does not dominate the timings.
+static bool verbose = true;
+
+// Client Class "Customer"
+class Customer{
+private:
+    string name;
+    int savings;
+    int badLoans;
+    int creditScore;
+public:
+    Customer(string customer_name, int customer_savings, int bad_loans, int credit_score) {
+        name = move(customer_name);
+        savings = customer_savings;
+        badLoans = bad_loans;
+        creditScore = credit_score;
+    }
+    const string &getName() const {return name;}
+    int getSavings() const {return savings;}
+    int getBadLoans() const {return badLoans;}
+    int getCreditScore() const {return creditScore;}
+};
+
+// A single row of the batch: who applies and for how much.
+struct Application{
+    Customer customer;
+    int amount;
+};
+
+// Indices of the applications that are still eligible.
+using Selection = vector<uint32_t>;
+
+// Column-wise copy of the fields the subsystems look at. Names are not
+// needed by any check, so they are never copied.
+class ApplicationBatch{
+public:
+    explicit ApplicationBatch(span<const Application> applications) {
+        size_t n = applications.size();
+        amounts.resize(n);
+        savings.resize(n);
+        badLoans.resize(n);
+        creditScores.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            const Customer &c = applications[i].customer;
+            amounts[i] = applications[i].amount;
+            savings[i] = c.getSavings();
+            badLoans[i] = c.getBadLoans();
+            creditScores[i] = c.getCreditScore();
+        }
+    }
+    size_t size() const {return amounts.size();}
+
+    vector<int> amounts;
+    vector<int> savings;
+    vector<int> badLoans;
+    vector<int> creditScores;
+};
+
+// Subsystem Class 1. "Bank"
+class Bank{
+public:
+    bool HasSufficientSavings(const Customer &customer, int amount){
+        if (verbose)
+            cout << "Check bank balance of " << customer.getName()
+                 << " for the amount " << amount << endl;
+        return customer.getSavings() >= amount / 5; // 20% down payment
+    }
+
+    // First stage: scans every row and fills the selection with the
+    // applications that have sufficient savings.
+    void HasSufficientSavings(const ApplicationBatch &batch, Selection &selection){
+        selection.resize(batch.size());
+        const int *amounts = batch.amounts.data();
+        const int *savings = batch.savings.data();
+        size_t kept = 0;
+        for (uint32_t i = 0; i < batch.size(); i++) {
+            selection[kept] = i;
+            kept += savings[i] >= amounts[i] / 5;
+        }
+        selection.resize(kept);
+    }
+};
+
+// Subsystem Class 2. "Credit"
+class Credit{
+public:
+    bool HasGoodCredit(const Customer &customer) {
+        if (verbose)
+            cout << "Check credit for " << customer.getName() << endl;
+        return customer.getCreditScore() > 650;
+    }
+
+    // Keeps only the selected applications with a good credit score.
+    void HasGoodCredit(const ApplicationBatch &batch, Selection &selection){
+        const int *scores = batch.creditScores.data();
+        size_t kept = 0;
+        for (uint32_t i : selection) {
+            selection[kept] = i;
+            kept += scores[i] > 650;
+        }
+        selection.resize(kept);
+    }
+};
+
+// Subsystem Class 3. "Loan"
+class Loan {
+public:
+    bool HasNoBadLoans(const Customer &customer) {
+        if (verbose)
+            cout << "Check outstanding loans for " << customer.getName() << endl;
+        return customer.getBadLoans() == 0;
+    }
+
+    // Keeps only the selected applications without bad loans.
+    void HasNoBadLoans(const ApplicationBatch &batch, Selection &selection){
+        const int *badLoans = batch.badLoans.data();
+        size_t kept = 0;
+        for (uint32_t i : selection) {
+            selection[kept] = i;
+            kept += badLoans[i] == 0;
+        }
+        selection.resize(kept);
+    }
+};
+
+// Facade "Mortgage"
+class Mortgage{
+private:
+    Bank *bank;
+    Loan *loan;
+    Credit *credit;
+public:
+    Mortgage() {
+        bank = new Bank();
+        loan = new Loan();
+        credit = new Credit();
+    }
+
+    bool isEligible(const Customer &customer, int amount) {
+        if (verbose)
+            cout << customer.getName() << " applies for " << amount << "TL loan" << endl;
+        bool eligible = true;
+
+        //Check applicant creditworthiness
+        if (!bank->HasSufficientSavings(customer, amount)){
+            eligible = false;
+        }
+        else if (!loan->HasNoBadLoans(customer)) {
+            eligible = false;
+        }
+        else if (!credit->HasGoodCredit(customer)) {
+            eligible = false;
+        }
+        return eligible;
+    }
+
+    // Batch check. Returns the indices of the eligible applications in
+    // ascending order. Each stage only sees the survivors of the previous one.
+    Selection isEligible(const ApplicationBatch &batch) {
+        Selection selection;
+        bank->HasSufficientSavings(batch, selection);
+        loan->HasNoBadLoans(batch, selection);
+        credit->HasGoodCredit(batch, selection);
+        return selection;
+    }
+
+    Selection isEligible(span<const Application> applications) {
+        return isEligible(ApplicationBatch(applications));
+    }
+};
+
+// Random applicants: most have enough savings and no bad loans, credit
+// scores are spread over 300-850.
+vector<Application> makeApplications(size_t count) {
+    mt19937 gen(42);
+    uniform_int_distribution<> savings(0, 100000);
+    uniform_int_distribution<> badLoans(0, 9);
+    uniform_int_distribution<> score(300, 850);
+    uniform_int_distribution<> amount(50000, 300000);
+
+    vector<Application> applications;
+    applications.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        int loans = badLoans(gen) == 0 ? 1 : 0; // 10% have a bad loan
+        applications.push_back({Customer("C" + to_string(i), savings(gen), loans, score(gen)), amount(gen)});
+    }
+    return applications;
+}
+
+// Best of a few runs, in milliseconds.
+template <typename F>
+double bestOf(int runs, F f) {
+    double best = 1e300;
+    for (int r = 0; r < runs; r++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        auto end = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]){
+// Facade
+Mortgage *mortgage;
+mortgage = new Mortgage();
+
+// Evaluate mortgage eligibility for a single customer
+Customer *customer;
+customer = new Customer("Ufuk Celikkan", 40000, 0, 720);
+bool eligible = mortgage->isEligible(*customer, 100000);
+cout << customer->getName() << " has been "
+                << (eligible ? "approved." : "rejected.") << endl;
+
+// Benchmark: N applications (default 10M), one at a time vs. as a batch
+size_t count = argc > 1 ? stoul(argv[1]) : 10000000;
+cout << endl << "Generating " << count << " applications..." << endl;
+vector<Application> applications = makeApplications(count);
+verbose = false;
+
+size_t approvedLoop = 0, approvedSpan = 0, approvedColumns = 0;
+double loopMs = bestOf(3, [&] {
+    approvedLoop = 0;
+    for (const Application &a : applications)
+        approvedLoop += mortgage->isEligible(a.customer, a.amount);
+});
+double spanMs = bestOf(3, [&] {approvedSpan = mortgage->isEligible(applications).size();});
+ApplicationBatch batch(applications);
+double columnsMs = bestOf(3, [&] {approvedColumns = mortgage->isEligible(batch).size();});
+
+cout << "isEligible loop          : " << approvedLoop << " approved in " << loopMs << " ms" << endl;
+cout << "isEligible span          : " << approvedSpan << " approved in " << spanMs << " ms"
+     << " (" << loopMs / spanMs << "x, includes building the columns)" << endl;
+cout << "isEligible batch columns : " << approvedColumns << " approved in " << columnsMs << " ms"
+     << " (" << loopMs / columnsMs << "x)" << endl;
+}
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : FacadeCache.cpp
+//
+//Caching variant of Facade.cpp. Repeat applicants are answered from a
+//result cache that sits between the facade and each subsystem:
+//1. Facade   (Mortgage)
+//		- same isEligible as Facade.cpp. When a ResultCache is plugged in
+//		  for a subsystem, the facade asks the cache, and the cache only
+//		  calls the subsystem on a miss.
+//2. Subsystem classes   (Bank, Credit, Loan)
+//		- stand-ins for slow remote lookups (they sleep before answering)
+//		  and count how often they are really called.
+//3. ResultCache
+//		- splits its keys over shards, each with its own lock and LRU list,
+//		  so that threads asking about different customers rarely meet.
+//		- entries expire after a TTL; rejections (false) are cached too,
+//		  with their own TTL ("negative caching").
+//		- concurrent misses on the same key are coalesced: only the first
+//		  caller runs the lookup, the others wait for its answer.
+//============================================================================
+
+using Clock = chrono::steady_clock;
+
+// When false, the facade does not narrate its checks. The benchmark turns
+// it off so that cout does not end up in the measurements.
+static bool verbose = true;
+
+// Client Class "Customer"
+class Customer{
+private:
+    string name;
+    int savings;
+    int badLoans;
+    int creditScore;
+public:
+    Customer(string customer_name, int customer_savings, int bad_loans, int credit_score) {
+        name = move(customer_name);
+        savings = customer_savings;
+        badLoans = bad_loans;
+        creditScore = credit_score;
+    }
+    const string &getName() const {return name;}
+    int getSavings() const {return savings;}
+    int getBadLoans() const {return badLoans;}
+    int getCreditScore() const {return creditScore;}
+};
+
+// Counters of a ResultCache, copied out by ResultCache::stats().
+struct CacheStats{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t coalesced;   // misses that waited for another caller's lookup
+    uint64_t evictions;   // entries pushed out because a shard was full
+    uint64_t expirations; // entries dropped because their TTL had passed
+};
+
+class ResultCache{
+public:
+    // capacity is the total number of entries, split evenly over the shards.
+    // A negativeTtl of zero disables caching of rejections.
+    ResultCache(size_t capacity, chrono::milliseconds ttl, chrono::milliseconds negativeTtl,
+                size_t shardCount = 16) {
+        _ttl = ttl;
+        _negativeTtl = negativeTtl;
+        _shardCapacity = max<size_t>(1, capacity / shardCount);
+        _shards = vector<Shard>(shardCount);
+    }
+
+    // Returns the cached answer for key, or calls lookup (once, even if
+    // several threads miss on the same key at the same time) and caches it.
+    bool get(const string &key, const function<bool()> &lookup) {
+        Shard &shard = _shards[hash<string>{}(key) % _shards.size()];
+        unique_lock<mutex> lock(shard.lock);
+
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            auto entry = found->second;
+            if (Clock::now() < entry->expires) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+                _hits++;
+                return entry->value;
+            }
+            shard.index.erase(found);
+            shard.lru.erase(entry);
+            _expirations++;
+        }
+        _misses++;
+
+        auto flight = shard.inflight.find(key);
+        if (flight != shard.inflight.end()) {
+            shared_future<bool> answer = flight->second;
+            lock.unlock();
+            _coalesced++;
+            return answer.get();
+        }
+
+        promise<bool> result;
+        shard.inflight.emplace(key, result.get_future().share());
+        lock.unlock();
+
+        bool value;
+        try {
+            value = lookup();
+        }
+        catch (...) { // let the waiters see the error too, and cache nothing
+            result.set_exception(current_exception());
+            lock.lock();
+            shard.inflight.erase(key);
+            throw;
+        }
+        result.set_value(value);
+
+        lock.lock();
+        shard.inflight.erase(key);
+        chrono::milliseconds ttl = value ? _ttl : _negativeTtl;
+        if (ttl.count() > 0) {
+            if (shard.lru.size() >= _shardCapacity) {
+                shard.index.erase(shard.lru.back().key);
+                shard.lru.pop_back();
+                _evictions++;
+            }
+            shard.lru.push_front({key, value, Clock::now() + ttl});
+            shard.index[key] = shard.lru.begin();
+        }
+        return value;
+    }
+
+    CacheStats stats() const {
+        return {_hits.load(), _misses.load(), _coalesced.load(), _evictions.load(), _expirations.load()};
+    }
+
+private:
+    struct Entry{
+        string key;
+        bool value;
+        Clock::time_point expires;
+    };
+    struct Shard{
+        mutex lock;
+        list<Entry> lru; // most recently used first
+        unordered_map<string, list<Entry>::iterator> index;
+        unordered_map<string, shared_future<bool>> inflight;
+    };
+
+    vector<Shard> _shards;
+    size_t _shardCapacity;
+    chrono::milliseconds _ttl{};
+    chrono::milliseconds _negativeTtl{};
+    atomic<uint64_t> _hits{0}, _misses{0}, _coalesced{0}, _evictions{0}, _expirations{0};
+};
+
+// Sleeps like a remote call would and counts the calls.
+class RemoteLookup{
+public:
+    explicit RemoteLookup(chrono::microseconds latency) {_latency = latency;}
+    void call() {
+        calls++;
+        this_thread::sleep_for(_latency);
+    }
+    atomic<uint64_t> calls{0};
+private:
+    chrono::microseconds _latency;
+};
+
+// Subsystem Class 1. "Bank"
+class Bank{
+public:
+    explicit Bank(chrono::microseconds latency) : remote(latency) {}
+    bool HasSufficientSavings(const Customer &customer, int amount){
+        remote.call();
+        return customer.getSavings() >= amount / 5; // 20% down payment
+    }
+    RemoteLookup remote;
+};
+
+// Subsystem Class 2. "Credit"
+class Credit{
+public:
+    explicit Credit(chrono::microseconds latency) : remote(latency) {}
+    bool HasGoodCredit(const Customer &customer) {
+        remote.call();
+        return customer.getCreditScore() > 650;
+    }
+    RemoteLookup remote;
+};
+
+// Subsystem Class 3. "Loan"
+class Loan {
+public:
+    explicit Loan(chrono::microseconds latency) : remote(latency) {}
+    bool HasNoBadLoans(const Customer &customer) {
+        remote.call();
+        return customer.getBadLoans() == 0;
+    }
+    RemoteLookup remote;
+};
+
+// Facade "Mortgage"
+class Mortgage{
+private:
+    Bank *bank;
+    Loan *loan;
+    Credit *credit;
+    ResultCache *bankCache = nullptr;
+    ResultCache *loanCache = nullptr;
+    ResultCache *creditCache = nullptr;
+public:
+    Mortgage(Bank *b, Loan *l, Credit *c) {
+        bank = b;
+        loan = l;
+        credit = c;
+    }
+
+    // Plugs a cache in front of each subsystem; nullptr means no cache.
+    void setCaches(ResultCache *forBank, ResultCache *forLoan, ResultCache *forCredit) {
+        bankCache = forBank;
+        loanCache = forLoan;
+        creditCache = forCredit;
+    }
+
+    bool isEligible(const Customer &customer, int amount) {
+        if (verbose)
+            cout << customer.getName() << " applies for " << amount << "TL loan" << endl;
+        bool eligible = true;
+
+        //Check applicant creditworthiness
+        if (!hasSufficientSavings(customer, amount)){
+            eligible = false;
+        }
+        else if (!hasNoBadLoans(customer)) {
+            eligible = false;
+        }
+        else if (!hasGoodCredit(customer)) {
+            eligible = false;
+        }
+        return eligible;
+    }
+
+private:
+    bool hasSufficientSavings(const Customer &customer, int amount) {
+        if (bankCache == nullptr) return bank->HasSufficientSavings(customer, amount);
+        return bankCache->get(customer.getName() + '/' + to_string(amount),
+                              [&] {return bank->HasSufficientSavings(customer, amount);});
+    }
+    bool hasNoBadLoans(const Customer &customer) {
+        if (loanCache == nullptr) return loan->HasNoBadLoans(customer);
+        return loanCache->get(customer.getName(), [&] {return loan->HasNoBadLoans(customer);});
+    }
+    bool hasGoodCredit(const Customer &customer) {
+        if (creditCache == nullptr) return credit->HasGoodCredit(customer);
+        return creditCache->get(customer.getName(), [&] {return credit->HasGoodCredit(customer);});
+    }
+};
+
+// Draws customer indices with P(k) proportional to 1 / (k + 1)^s.
+class Zipf{
+public:
+    Zipf(size_t n, double s) {
+        _cdf.resize(n);
+        double sum = 0;
+        for (size_t k = 0; k < n; k++) {
+            sum += 1.0 / pow((double) (k + 1), s);
+            _cdf[k] = sum;
+        }
+        for (double &c : _cdf) c /= sum;
+    }
+    size_t operator()(mt19937 &gen) {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(gen);
+        return min(_cdf.size() - 1, (size_t) (lower_bound(_cdf.begin(), _cdf.end(), u) - _cdf.begin()));
+    }
+private:
+    vector<double> _cdf;
+};
+
+// Runs `requests` applications spread over `threads` threads and returns
+// the throughput in applications per second.
+double runWorkload(Mortgage &mortgage, const vector<Customer> &customers, int threads, int requests) {
+    Zipf zipf(customers.size(), 1.1);
+    Clock::time_point start = Clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            mt19937 gen(t + 1);
+            Zipf local = zipf;
+            for (int i = 0; i < requests / threads; i++)
+                mortgage.isEligible(customers[local(gen)], 100000);
+        });
+    }
+    for (thread &w : workers) w.join();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    return requests / seconds;
+}
+
+void printStats(const string &name, const ResultCache &cache) {
+    CacheStats s = cache.stats();
+    cout << "\t" << name << " cache: " << s.hits << " hits, " << s.misses << " misses ("
+         << s.coalesced << " coalesced), " << s.evictions << " evictions, "
+         << s.expirations << " expirations" << endl;
+}
+
+int main(int argc, char *argv[]){
+// Facade over slow subsystems (500us per remote call)
+auto latency = chrono::microseconds(500);
+Bank *bank = new Bank(latency);
+Loan *loan = new Loan(latency);
+Credit *credit = new Credit(latency);
+Mortgage *mortgage = new Mortgage(bank, loan, credit);
+
+// Evaluate mortgage eligibility for customer
+Customer *customer = new Customer("Ufuk Celikkan", 40000, 0, 720);
+bool eligible = mortgage->isEligible(*customer, 100000);
+cout << customer->getName() << " has been "
+                << (eligible ? "approved." : "rejected.") << endl;
+
+// Benchmark: Zipfian applicants, first without and then with caches
+int requests = argc > 1 ? stoi(argv[1]) : 20000;
+int threads = 8;
+verbose = false;
+mt19937 gen(7);
+uniform_int_distribution<> savings(0, 100000);
+uniform_int_distribution<> badLoans(0, 9);
+uniform_int_distribution<> score(300, 850);
+vector<Customer> customers;
+for (int i = 0; i < 100000; i++)
+    customers.emplace_back("C" + to_string(i), savings(gen), badLoans(gen) == 0 ? 1 : 0, score(gen));
+
+cout << endl << requests << " Zipfian applications from " << customers.size()
+     << " customers on " << threads << " threads" << endl;
+auto backendCalls = [&] {return bank->remote.calls + loan->remote.calls + credit->remote.calls;};
+
+uint64_t before = backendCalls();
+double uncached = runWorkload(*mortgage, customers, threads, requests);
+cout << "without cache: " << uncached << " applications/s, "
+     << backendCalls() - before << " backend calls" << endl;
+
+ResultCache bankCache(10000, chrono::minutes(5), chrono::seconds(30));
+ResultCache loanCache(10000, chrono::minutes(5), chrono::seconds(30));
+ResultCache creditCache(10000, chrono::minutes(1), chrono::seconds(10));
+mortgage->setCaches(&bankCache, &loanCache, &creditCache);
+
+before = backendCalls();
+double cached = runWorkload(*mortgage, customers, threads, requests);
+cout << "with cache   : " << cached << " applications/s, "
+     << backendCalls() - before << " backend calls" << endl;
+printStats("bank", bankCache);
+printStats("loan", loanCache);
+printStats("credit", creditCache);
+}
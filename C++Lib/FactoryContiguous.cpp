@@ -0,0 +1,274 @@
+#include <chrono>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
+#include <vector>
+using namespace std;
+
+
+//============================================================================
+//Name        : FactoryContiguous.cpp
+//
+//Variant of FactoryPattern.cpp in which the Creator keeps its products by
+//value instead of as separate heap objects:
+//1. Product  (Engine,Transmission - Abstract)
+//2. ConcreteProduct  (OPEL_Engine, OPEL_Transmission)
+//	 Same as FactoryPattern.cpp, except that the name is a string literal
+//	 instead of a string member, so a product never allocates.
+//3. Creator  (CarCreator)
+//	 Its factory methods construct the products inside a PartCollection
+//	 and return a reference to them.
+//4. ConcreteCreator (OPELCreator)
+//5. PartCollection
+//	 Keeps one contiguous block (a vector<T>) per concrete Part type.
+//	 forEach visits every part through the Part interface (virtual calls
+//	 still work, the objects are real Parts); for_each_of_type<T> walks a
+//	 single block as T, so calls to final classes need no indirection.
+//	 Adding parts may move the existing ones, so do not keep references
+//	 across emplace().
+//============================================================================
+
+// When false, products are created silently. The benchmark turns it off.
+static bool verbose = true;
+
+// Top "Abstract Product" Part Class;
+class Part{
+public:
+    virtual ~Part() = default;
+    virtual string displayName() = 0;
+    virtual double getPrice() = 0;
+};
+
+// Engine base class
+class Engine: public Part{
+protected:
+    double price{};
+    const char *name{};
+public:
+    double getPrice() override {return price;}
+    string displayName() override {return name;}
+};
+
+//Transmission base class
+class Transmission: public Part{
+protected:
+    double price{};
+    const char *name{};
+public:
+    double getPrice() override {return price;}
+    string displayName() override {return name;}
+};
+
+//A 'ConcreteProduct' class
+
+class OPEL_Engine final : public Engine {
+public:
+    explicit OPEL_Engine(double p) {
+        price = p;
+        name = "OPEL Engine";
+        if (verbose) cout << "OPEL Engine is created..." << endl;
+
+    }
+};
+
+//A 'ConcreteProduct ' class
+class OPEL_Transmission final : public Transmission {
+public:
+    explicit OPEL_Transmission(double p) {
+        price = p;
+        name = "OPEL Transmission";
+        if (verbose) cout << "OPEL Transmission is created..." << endl;
+
+    }
+};
+
+// Polymorphic value container: one contiguous block per concrete type.
+class PartCollection{
+public:
+    template <typename T, typename... Args>
+    T &emplace(Args &&...args) {
+        return block<T>().items.emplace_back(forward<Args>(args)...);
+    }
+
+    // Calls f(Part&) for every part, block by block.
+    template <typename F>
+    void forEach(F f) {
+        for (auto &b : blocks) {
+            size_t n = b->size();
+            if (n == 0) continue;
+            // The Part subobject sits at the same offset in every item.
+            char *base = b->data();
+            size_t stride = b->stride();
+            ptrdiff_t offset = reinterpret_cast<char *>(b->part(base)) - base;
+            for (size_t i = 0; i < n; i++)
+                f(*reinterpret_cast<Part *>(base + i * stride + offset));
+        }
+    }
+
+    // Calls f(T&) for every part whose concrete type is T.
+    template <typename T, typename F>
+    void for_each_of_type(F f) {
+        size_t id = typeId<T>();
+        if (id >= byType.size() || byType[id] == nullptr) return;
+        for (T &item : static_cast<Block<T> *>(byType[id])->items)
+            f(item);
+    }
+
+    size_t size() const {
+        size_t n = 0;
+        for (auto &b : blocks) n += b->size();
+        return n;
+    }
+
+    void reserve_hint(size_t perType) {reserveHint = perType;}
+
+private:
+    struct AnyBlock{
+        virtual ~AnyBlock() = default;
+        virtual char *data() = 0;
+        virtual size_t size() const = 0;
+        virtual size_t stride() const = 0;
+        virtual Part *part(char *item) = 0;
+    };
+    template <typename T>
+    struct Block : AnyBlock{
+        vector<T> items;
+        char *data() override {return reinterpret_cast<char *>(items.data());}
+        size_t size() const override {return items.size();}
+        size_t stride() const override {return sizeof(T);}
+        Part *part(char *item) override {return reinterpret_cast<T *>(item);}
+    };
+
+    // Small dense number per concrete type, assigned on first use.
+    static size_t nextTypeId() {
+        static size_t next = 0;
+        return next++;
+    }
+    template <typename T>
+    static size_t typeId() {
+        static const size_t id = nextTypeId();
+        return id;
+    }
+
+    template <typename T>
+    Block<T> &block() {
+        size_t id = typeId<T>();
+        if (id >= byType.size()) byType.resize(id + 1);
+        AnyBlock *&slot = byType[id];
+        if (slot == nullptr) {
+            auto created = make_unique<Block<T>>();
+            created->items.reserve(reserveHint);
+            slot = created.get();
+            blocks.push_back(move(created));
+        }
+        return *static_cast<Block<T> *>(slot);
+    }
+
+    vector<unique_ptr<AnyBlock>> blocks;
+    vector<AnyBlock *> byType; // indexed by typeId<T>()
+    size_t reserveHint = 0;
+};
+
+//An 'Abstract Creator' class
+//--> CarCreator
+
+class CarCreator{
+    // Object creation is delegated to factory.
+public:
+    virtual ~CarCreator() = default;
+    virtual Engine &createEngine() = 0;
+    virtual Transmission &createTransmission() = 0;
+    void createCar() {
+        createEngine();
+        createTransmission();
+    }
+    // Parts are listed grouped by type, not in creation order.
+    void displayParts() {
+        cout << "\tListing Parts\n\t-------------" << endl;
+        parts.forEach([](Part &part) {cout << "\t" << part.displayName() << " " << part.getPrice() << endl;});
+    }
+    PartCollection &getParts() {return parts;}
+
+protected:
+    PartCollection parts;
+};
+
+//A 'ConcreteCreator' class ---> OPELCreator
+
+class OPELCreator : public CarCreator {
+    // Factory Method implementation
+    // We are overriding the factory method
+public:
+    OPEL_Engine &createEngine() override {
+        return parts.emplace<OPEL_Engine>(25000.00);
+    }
+    OPEL_Transmission &createTransmission() override {
+        return parts.emplace<OPEL_Transmission>(10000.00);
+    }
+};
+
+// Same products, kept the FactoryPattern.cpp way: one heap object each.
+class HeapOPELCreator {
+public:
+    void createCar() {
+        parts.push_back(new OPEL_Engine(25000.00));
+        parts.push_back(new OPEL_Transmission(10000.00));
+    }
+    vector<Part *> parts;
+};
+
+// Bytes currently handed out by malloc, including large mmap'ed blocks.
+size_t heapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template <typename F>
+double millis(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//Entry point into main application.
+int main(int argc, char *argv[]){
+    // Create an OPEL_car.
+    CarCreator *creator;
+    creator = new OPELCreator();
+    cout << "Creating OPEL" << endl;
+    creator->createCar();
+    creator->displayParts();
+
+    // Benchmark: N parts (default 10M), heap objects vs. contiguous blocks
+    size_t count = argc > 1 ? stoul(argv[1]) : 10000000;
+    size_t cars = count / 2;
+    verbose = false;
+    cout << endl << "Creating " << cars * 2 << " parts each way..." << endl;
+
+    size_t before = heapInUse();
+    OPELCreator contiguous;
+    contiguous.getParts().reserve_hint(cars);
+    double contiguousBuild = millis([&] {for (size_t i = 0; i < cars; i++) contiguous.createCar();});
+    size_t contiguousBytes = heapInUse() - before;
+
+    before = heapInUse();
+    HeapOPELCreator heap;
+    double heapBuild = millis([&] {for (size_t i = 0; i < cars; i++) heap.createCar();});
+    size_t heapBytes = heapInUse() - before;
+
+    double sum1 = 0, sum2 = 0, sum3 = 0;
+    double heapSum = millis([&] {for (Part *p : heap.parts) sum1 += p->getPrice();});
+    double virtualSum = millis([&] {contiguous.getParts().forEach([&](Part &p) {sum2 += p.getPrice();});});
+    double typedSum = millis([&] {
+        PartCollection &parts = contiguous.getParts();
+        parts.for_each_of_type<OPEL_Engine>([&](OPEL_Engine &e) {sum3 += e.getPrice();});
+        parts.for_each_of_type<OPEL_Transmission>([&](OPEL_Transmission &t) {sum3 += t.getPrice();});
+    });
+
+    cout << "vector<Part*>  : build " << heapBuild << " ms, " << heapBytes / (double) count
+         << " bytes/part, price sum " << sum1 << " in " << heapSum << " ms" << endl;
+    cout << "PartCollection : build " << contiguousBuild << " ms, " << contiguousBytes / (double) count
+         << " bytes/part" << endl;
+    cout << "  forEach          : price sum " << sum2 << " in " << virtualSum << " ms" << endl;
+    cout << "  for_each_of_type : price sum " << sum3 << " in " << typedSum << " ms" << endl;
+}
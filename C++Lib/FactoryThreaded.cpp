@@ -0,0 +1,345 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+using namespace std;
+
+
+//============================================================================
+//Name        : FactoryThreaded.cpp
+//
+//Variant of FactoryPattern.cpp for many worker threads creating cars at the
+//same time:
+//1. Product  (Engine,Transmission - Abstract)
+//2. ConcreteProduct  (OPEL_Engine, OPEL_Transmission)
+//	 Only announce themselves on cout when `verbose` is on, so that the
+//	 workers do not serialize on the stream. Names are string literals, so
+//	 constructing a product does not allocate a string either.
+//3. Creator  (CarCreator)
+//4. ConcreteCreator (OPELCreator, PooledOPELCreator)
+//	 PooledOPELCreator returns Pooled<> products. Their memory comes from a
+//	 pool owned by the creating thread, not from the global allocator.
+//5. ThreadCache<T>
+//	 Per-thread pool of slots for T with a private free list. A slot freed
+//	 by its own thread goes straight back on the free list. A slot freed by
+//	 another thread is collected in a batch, and the whole batch is handed
+//	 back to the owner with a single atomic push. When a thread exits its
+//	 pool is parked and adopted by the next thread that needs one.
+//============================================================================
+
+// When false, products are created silently. The benchmark turns it off.
+static bool verbose = true;
+
+// Top "Abstract Product" Part Class;
+class Part{
+public:
+    virtual ~Part() = default;
+    virtual string displayName() = 0;
+    virtual double getPrice() = 0;
+};
+
+// Engine base class
+class Engine: public Part{
+protected:
+    double price{};
+    const char *name{};
+public:
+    double getPrice() override {return price;}
+    string displayName() override {return name;}
+};
+
+//Transmission base class
+class Transmission: public Part{
+protected:
+    double price{};
+    const char *name{};
+public:
+    double getPrice() override {return price;}
+    string displayName() override {return name;}
+};
+
+//A 'ConcreteProduct' class
+
+class OPEL_Engine : public Engine {
+public:
+    explicit OPEL_Engine(double p) {
+        price = p;
+        name = "OPEL Engine";
+        if (verbose) cout << "OPEL Engine is created..." << endl;
+
+    }
+};
+
+//A 'ConcreteProduct ' class
+class OPEL_Transmission : public Transmission {
+public:
+    explicit OPEL_Transmission(double p) {
+        price = p;
+        name = "OPEL Transmission";
+        if (verbose) cout << "OPEL Transmission is created..." << endl;
+
+    }
+};
+
+template <typename T>
+class ThreadCache{
+public:
+    static void *allocate() {
+        Pool *pool = local().pool;
+        if (pool->free == nullptr) pool->refill();
+        Slot *slot = pool->free;
+        pool->free = slot->next;
+        return slot->storage;
+    }
+
+    static void deallocate(void *p) {
+        Slot *slot = reinterpret_cast<Slot *>(static_cast<unsigned char *>(p) - offsetof(Slot, storage));
+        Handle &handle = local();
+        if (slot->owner == handle.pool) {
+            slot->next = handle.pool->free;
+            handle.pool->free = slot;
+        }
+        else {
+            handle.handBack(slot);
+        }
+    }
+
+private:
+    static constexpr size_t ChunkSlots = 256; // slots allocated at once
+    static constexpr size_t BatchSlots = 64;  // slots handed back at once
+    static constexpr size_t Outboxes = 4;     // owners batched at the same time
+
+    struct Pool;
+    struct Slot{
+        Pool *owner;
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Pool{
+        Slot *free = nullptr;            // only touched by the owning thread
+        atomic<Slot *> returned{nullptr}; // pushed by other threads
+
+        void refill() {
+            free = returned.exchange(nullptr, memory_order_acquire);
+            if (free != nullptr) return;
+            Slot *chunk = static_cast<Slot *>(::operator new(ChunkSlots * sizeof(Slot)));
+            for (size_t i = 0; i < ChunkSlots; i++) {
+                chunk[i].owner = this;
+                chunk[i].next = i + 1 < ChunkSlots ? &chunk[i + 1] : nullptr;
+            }
+            free = chunk;
+        }
+    };
+
+    // Slots freed by this thread that belong to another thread's pool.
+    struct Outbox{
+        Pool *owner = nullptr;
+        Slot *head = nullptr;
+        Slot *tail = nullptr;
+        size_t count = 0;
+
+        void flush() {
+            if (count == 0) return;
+            Slot *top = owner->returned.load(memory_order_relaxed);
+            do {
+                tail->next = top;
+            } while (!owner->returned.compare_exchange_weak(top, head, memory_order_release,
+                                                             memory_order_relaxed));
+            head = tail = nullptr;
+            count = 0;
+        }
+    };
+
+    // The calling thread's pool and outboxes. Created on first use and
+    // released when the thread exits.
+    struct Handle{
+        Pool *pool;
+        Outbox outboxes[Outboxes];
+        size_t nextVictim = 0;
+
+        Handle() {pool = adoptPool();}
+        ~Handle() {
+            for (Outbox &box : outboxes) box.flush();
+            parkPool(pool);
+        }
+
+        void handBack(Slot *slot) {
+            Outbox *box = nullptr;
+            for (Outbox &candidate : outboxes) {
+                if (candidate.owner == slot->owner) {box = &candidate; break;}
+                if (candidate.count == 0 && box == nullptr) box = &candidate;
+            }
+            if (box == nullptr) { // all outboxes busy with other owners
+                box = &outboxes[nextVictim++ % Outboxes];
+                box->flush();
+            }
+            box->owner = slot->owner;
+            slot->next = box->head;
+            box->head = slot;
+            if (box->tail == nullptr) box->tail = slot;
+            if (++box->count == BatchSlots) box->flush();
+        }
+    };
+
+    static Handle &local() {
+        thread_local Handle handle;
+        return handle;
+    }
+
+    // Pools are never destroyed: objects may outlive the thread that made
+    // them, so a finished thread's pool waits here for the next thread.
+    static mutex &parkingLock() {
+        static mutex lock;
+        return lock;
+    }
+    static vector<Pool *> &parked() {
+        static vector<Pool *> pools;
+        return pools;
+    }
+    static Pool *adoptPool() {
+        lock_guard<mutex> guard(parkingLock());
+        if (parked().empty()) return new Pool();
+        Pool *pool = parked().back();
+        parked().pop_back();
+        return pool;
+    }
+    static void parkPool(Pool *pool) {
+        lock_guard<mutex> guard(parkingLock());
+        parked().push_back(pool);
+    }
+};
+
+// A product whose memory comes from the creating thread's ThreadCache.
+template <typename Product>
+class Pooled final : public Product {
+public:
+    using Product::Product;
+    static void *operator new(size_t size) {
+        if (size != sizeof(Pooled)) throw bad_alloc();
+        return ThreadCache<Pooled>::allocate();
+    }
+    static void operator delete(void *p) {ThreadCache<Pooled>::deallocate(p);}
+};
+
+//An 'Abstract Creator' class
+//--> CarCreator
+
+class CarCreator{
+    // Object creation is delegated to factory.
+public:
+    virtual ~CarCreator() = default;
+    virtual Engine* createEngine() = 0;
+    virtual Transmission* createTransmission() = 0;
+    void createCar() {
+        parts.push_back(createEngine());
+        parts.push_back(createTransmission());
+    }
+    void displayParts() {
+        cout << "\tListing Parts\n\t-------------" << endl;
+        for (Part* partPtr: parts) { cout << "\t" << partPtr->displayName() << " " << partPtr->getPrice() << endl;}
+    }
+    // Hands the parts created so far to the caller.
+    vector<Part *> takeParts() {return move(parts);}
+
+private:
+    vector<Part *> parts;
+};
+
+//A 'ConcreteCreator' class ---> OPELCreator
+
+class OPELCreator : public CarCreator {
+    // Factory Method implementation
+    // We are overriding the factory method
+public:
+    OPEL_Engine *createEngine() override {
+        return new OPEL_Engine (25000.00);
+    }
+    OPEL_Transmission *createTransmission() override {
+        return new OPEL_Transmission(10000.00);
+    }
+};
+
+//A 'ConcreteCreator' class ---> PooledOPELCreator
+
+class PooledOPELCreator : public CarCreator {
+public:
+    OPEL_Engine *createEngine() override {
+        return new Pooled<OPEL_Engine>(25000.00);
+    }
+    OPEL_Transmission *createTransmission() override {
+        return new Pooled<OPEL_Transmission>(10000.00);
+    }
+};
+
+// Thread-safe hand-off of whole batches of parts between workers.
+class Mailbox{
+public:
+    void put(vector<Part *> batch) {
+        lock_guard<mutex> guard(lock);
+        batches.push_back(move(batch));
+    }
+    vector<vector<Part *>> takeAll() {
+        lock_guard<mutex> guard(lock);
+        return move(batches);
+    }
+private:
+    mutex lock;
+    vector<vector<Part *>> batches;
+};
+
+// Every worker builds cars in batches of 500 and passes each batch to the
+// next worker, who destroys it. With more than one thread every part is
+// therefore freed by a thread other than the one that created it.
+template <typename Creator>
+double carsPerSecond(int threads, size_t carsPerThread) {
+    vector<Mailbox> mailboxes(threads);
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            Creator creator;
+            auto destroy = [](vector<vector<Part *>> batches) {
+                for (auto &batch : batches)
+                    for (Part *part : batch) delete part;
+            };
+            for (size_t made = 0; made < carsPerThread; made += 500) {
+                for (size_t i = 0; i < 500; i++) creator.createCar();
+                mailboxes[(t + 1) % threads].put(creator.takeParts());
+                destroy(mailboxes[t].takeAll());
+            }
+        });
+    }
+    for (thread &w : workers) w.join();
+    for (Mailbox &box : mailboxes)
+        for (auto &batch : box.takeAll())
+            for (Part *part : batch) delete part;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return threads * carsPerThread / seconds;
+}
+
+//Entry point into main application.
+int main(int argc, char *argv[]){
+    // Create an OPEL_car.
+    CarCreator *creator;
+    creator = new PooledOPELCreator();
+    cout << "Creating OPEL" << endl;
+    creator->createCar();
+    creator->displayParts();
+
+    // Benchmark: cars/s with 1..64 threads, global allocator vs. pools
+    size_t carsPerThread = argc > 1 ? stoul(argv[1]) : 200000;
+    verbose = false;
+    cout << endl << carsPerThread << " cars per thread (" << thread::hardware_concurrency()
+         << " hardware threads)" << endl;
+    cout << "threads\tOPELCreator cars/s\tPooledOPELCreator cars/s" << endl;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        double heap = carsPerSecond<OPELCreator>(threads, carsPerThread);
+        double pooled = carsPerSecond<PooledOPELCreator>(threads, carsPerThread);
+        cout << threads << "\t" << heap << "\t\t" << pooled << endl;
+    }
+}
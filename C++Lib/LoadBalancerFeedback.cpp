@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : LoadBalancerFeedback.cpp
+//============================================================================
+//Variant of SingletonPattern.cpp that learns from the requests it routes:
+//1. Singleton   (LoadBalancer)
+//		. Callers report each request's latency and outcome (Feedback, or
+//		  Request::finish).
+//		. Per server, lock-free: a peak-EWMA of latency (jumps up to a
+//		  slower sample at once, decays towards faster ones with a 1 s time
+//		  constant), an EWMA of the error rate and the outstanding requests.
+//		. getServer compares two random servers (power of two choices) by
+//		  cost = latency EWMA * (outstanding + 1) / (1 - error rate).
+//		. A server failing EjectionSettings.failures times in a row is
+//		  left out for EjectionSettings.duration, twice as long each
+//		  further time (up to maxDuration); at most half of the servers are
+//		  out at once. An ejection first reserves one of those slots with a
+//		  compare-and-swap, so concurrent reporters cannot overshoot.
+//		. Policy::Random ignores all of it, for comparison.
+
+uint64_t nowNs() {
+    return (uint64_t) chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift64*, one per thread (see LoadBalancerPolicies.cpp).
+class FastRandom{
+public:
+    FastRandom() {
+        random_device randomDevice;
+        state = ((uint64_t) randomDevice() << 32 | randomDevice()) | 1;
+    }
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+    uint32_t below(uint32_t n) {return (uint32_t) (((next() >> 32) * n) >> 32);}
+private:
+    uint64_t state;
+};
+
+FastRandom &threadRandom() {
+    thread_local FastRandom random;
+    return random;
+}
+
+// A double updated with compare-and-swap.
+class AtomicDouble{
+public:
+    explicit AtomicDouble(double value = 0) : bits(bit_cast<uint64_t>(value)) {}
+    double load() const {return bit_cast<double>(bits.load(memory_order_relaxed));}
+    void store(double value) {bits.store(bit_cast<uint64_t>(value), memory_order_relaxed);}
+    // Replaces the value with f(value).
+    template <typename F>
+    void update(F f) {
+        uint64_t old = bits.load(memory_order_relaxed);
+        while (!bits.compare_exchange_weak(old, bit_cast<uint64_t>(f(bit_cast<double>(old))),
+                                           memory_order_relaxed)) {}
+    }
+private:
+    atomic<uint64_t> bits;
+};
+
+enum class Policy {Random, PeakEwma};
+
+//This is the "Singleton" class.
+class LoadBalancer{
+public:
+    struct EjectionSettings{
+        uint32_t failures = 5;                    // consecutive, to eject
+        chrono::milliseconds duration{500};       // first ejection
+        chrono::milliseconds maxDuration{8000};
+    };
+
+    static LoadBalancer *GetLoadBalancer() {
+        static LoadBalancer instance;
+        return &instance;
+    }
+
+    // A request in flight. finish() reports it; a Request destroyed
+    // without finishing only stops counting as outstanding.
+    class Request{
+    public:
+        Request(LoadBalancer *lb, uint32_t server) : _lb(lb), _server(server), _start(nowNs()) {
+            _lb->servers[server].outstanding.fetch_add(1, memory_order_relaxed);
+        }
+        Request(const Request &) = delete;
+        Request &operator=(const Request &) = delete;
+        ~Request() {if (!_finished) _lb->servers[_server].outstanding.fetch_sub(1, memory_order_relaxed);}
+        void finish(bool success) {
+            if (_finished) return;
+            _finished = true;
+            _lb->servers[_server].outstanding.fetch_sub(1, memory_order_relaxed);
+            _lb->Feedback(_server, chrono::nanoseconds(nowNs() - _start), success);
+        }
+        uint32_t index() const {return _server;}
+        const string &server() const {return _lb->servers[_server].name;}
+    private:
+        LoadBalancer *_lb;
+        uint32_t _server;
+        uint64_t _start;
+        bool _finished = false;
+    };
+
+    void setPolicy(Policy value) {policy.store(value, memory_order_relaxed);}
+    void setEjection(EjectionSettings value) {eject = value;}
+
+    // Forgets everything learned so far.
+    void reset() {
+        for (Server &s : servers) {
+            s.latencyNs.store(InitialLatencyNs);
+            s.errorRate.store(0);
+            s.lastSampleNs.store(nowNs());
+            s.consecutiveFailures.store(0);
+            s.ejectedUntilNs.store(0);
+            s.ejections.store(0);
+        }
+        ejectedSlots.store(0);
+    }
+
+    uint32_t select() {
+        auto n = (uint32_t) servers.size();
+        FastRandom &random = threadRandom();
+        if (policy.load(memory_order_relaxed) == Policy::Random) return random.below(n);
+        uint64_t now = nowNs();
+        // two distinct servers that are not ejected; a few tries, then any
+        uint32_t a = random.below(n), b = random.below(n);
+        for (int tries = 0; tries < 8 && ejected(a, now); tries++) a = random.below(n);
+        for (int tries = 0; tries < 8 && (b == a || ejected(b, now)); tries++) b = random.below(n);
+        return cost(b) < cost(a) ? b : a;
+    }
+
+    Request beginRequest() {return {this, select()};}
+    const string &getServer() {return servers[select()].name;}
+
+    void Feedback(uint32_t index, chrono::nanoseconds latency, bool success) {
+        Server &s = servers[index];
+        uint64_t now = nowNs();
+        auto sample = (double) latency.count();
+        // weight of the old value after dt, with a 1 s time constant
+        uint64_t last = s.lastSampleNs.exchange(now, memory_order_relaxed);
+        double keep = exp(-(double) (now > last ? now - last : 0) / 1e9);
+        s.latencyNs.update([&](double ewma) {
+            return sample > ewma ? sample : ewma * keep + sample * (1 - keep);
+        });
+        s.errorRate.update([&](double rate) {return rate * 0.95 + (success ? 0 : 0.05);});
+
+        if (success) {
+            s.consecutiveFailures.store(0, memory_order_relaxed);
+            return;
+        }
+        if (s.consecutiveFailures.fetch_add(1, memory_order_relaxed) + 1 < eject.failures) return;
+        releaseExpired(now);
+        if (s.ejectedUntilNs.load(memory_order_relaxed) != 0 || !reserveEjectionSlot()) return;
+        // back off longer each time the server is ejected
+        auto duration = min<uint64_t>((uint64_t) eject.maxDuration.count(),
+                                      (uint64_t) eject.duration.count()
+                                      << min<uint32_t>(s.ejections.load(memory_order_relaxed), 16));
+        uint64_t notEjected = 0;
+        if (!s.ejectedUntilNs.compare_exchange_strong(notEjected, now + duration * 1000000,
+                                                      memory_order_relaxed)) {
+            ejectedSlots.fetch_sub(1, memory_order_relaxed); // another reporter ejected it first
+            return;
+        }
+        s.ejections.fetch_add(1, memory_order_relaxed);
+        s.consecutiveFailures.store(0, memory_order_relaxed);
+    }
+
+    double latencyEwmaMs(uint32_t i) const {return servers[i].latencyNs.load() / 1e6;}
+    double errorRate(uint32_t i) const {return servers[i].errorRate.load();}
+    uint32_t ejections(uint32_t i) const {return servers[i].ejections.load(memory_order_relaxed);}
+    const string &name(uint32_t i) const {return servers[i].name;}
+    size_t size() const {return servers.size();}
+
+private:
+    static constexpr double InitialLatencyNs = 1e6;
+
+    struct alignas(64) Server{
+        string name;
+        AtomicDouble latencyNs{InitialLatencyNs};
+        AtomicDouble errorRate{0};
+        atomic<uint64_t> lastSampleNs{0};
+        atomic<uint32_t> outstanding{0};
+        atomic<uint32_t> consecutiveFailures{0};
+        atomic<uint64_t> ejectedUntilNs{0}; // 0 when not holding an ejection slot
+        atomic<uint32_t> ejections{0};
+    };
+
+    LoadBalancer() : servers(5) {
+        const char *names[] = {"Server I", "Server II", "Server III", "Server IV", "Server V"};
+        for (size_t i = 0; i < servers.size(); i++) servers[i].name = names[i];
+        reset();
+    }
+
+    bool ejected(uint32_t i, uint64_t now) const {
+        return servers[i].ejectedUntilNs.load(memory_order_relaxed) > now;
+    }
+    // Takes one of the floor(n / 2) ejection slots, if one is free.
+    bool reserveEjectionSlot() {
+        uint32_t taken = ejectedSlots.load(memory_order_relaxed);
+        do {
+            if ((taken + 1) * 2 > servers.size()) return false;
+        } while (!ejectedSlots.compare_exchange_weak(taken, taken + 1, memory_order_relaxed));
+        return true;
+    }
+    // Gives back the slots of servers whose ejection is over; whoever
+    // clears ejectedUntilNs releases the slot.
+    void releaseExpired(uint64_t now) {
+        for (Server &s : servers) {
+            uint64_t until = s.ejectedUntilNs.load(memory_order_relaxed);
+            if (until != 0 && until <= now
+                && s.ejectedUntilNs.compare_exchange_strong(until, 0, memory_order_relaxed))
+                ejectedSlots.fetch_sub(1, memory_order_relaxed);
+        }
+    }
+    double cost(uint32_t i) const {
+        const Server &s = servers[i];
+        double errors = min(s.errorRate.load(), 0.9);
+        return s.latencyNs.load() * (s.outstanding.load(memory_order_relaxed) + 1) / (1 - errors);
+    }
+
+    vector<Server> servers;
+    atomic<Policy> policy{Policy::PeakEwma};
+    atomic<uint32_t> ejectedSlots{0}; // servers holding a slot, ejection over or not
+    EjectionSettings eject;
+};
+
+// A local stand-in for one backend: its latency grows with the requests
+// it is serving at once, and some of its requests fail.
+class FakeBackend{
+public:
+    FakeBackend(double baseMs, uint32_t capacity, double failureRate)
+            : baseMs(baseMs), capacity(capacity), failureRate(failureRate) {}
+
+    // Serves one request on the calling thread; returns success.
+    bool serve() {
+        uint32_t busy = active.fetch_add(1) + 1;
+        thread_local mt19937 gen(random_device{}());
+        lognormal_distribution<double> jitter(0, 0.3);
+        uniform_real_distribution<double> u(0, 1);
+        double ms = baseMs * jitter(gen) * max(1.0, (double) busy / capacity);
+        bool ok = u(gen) >= failureRate;
+        this_thread::sleep_for(chrono::microseconds((int64_t) ((ok ? ms : ms / 4) * 1000)));
+        active.fetch_sub(1);
+        return ok;
+    }
+
+private:
+    double baseMs;
+    uint32_t capacity;
+    double failureRate;
+    atomic<uint32_t> active{0};
+};
+
+struct SimulationResult{
+    vector<double> latenciesMs; // sorted
+    uint64_t failures;
+};
+
+// `clients` threads send requests back to back for `window`.
+SimulationResult simulate(LoadBalancer *lb, deque<FakeBackend> &backends, int clients, chrono::milliseconds window) {
+    atomic<bool> stop{false};
+    vector<vector<double>> latencies(clients);
+    atomic<uint64_t> failures{0};
+    vector<thread> threads;
+    for (int c = 0; c < clients; c++)
+        threads.emplace_back([&, c] {
+            while (!stop.load(memory_order_relaxed)) {
+                uint64_t start = nowNs();
+                LoadBalancer::Request request = lb->beginRequest();
+                bool ok = backends[request.index()].serve();
+                request.finish(ok);
+                latencies[c].push_back((double) (nowNs() - start) / 1e6);
+                if (!ok) failures++;
+            }
+        });
+    this_thread::sleep_for(window);
+    stop = true;
+    for (thread &t : threads) t.join();
+    SimulationResult result{{}, failures};
+    for (auto &l : latencies) result.latenciesMs.insert(result.latenciesMs.end(), l.begin(), l.end());
+    sort(result.latenciesMs.begin(), result.latenciesMs.end());
+    return result;
+}
+
+int main(int argc, char *argv[]){
+    LoadBalancer *lb = LoadBalancer::GetLoadBalancer();
+
+    // Server III answers slowly and Server V keeps failing
+    cout << "Reporting feedback for 200 requests...." << endl;
+    for (int i = 0; i < 200; i++) {
+        uint32_t s = lb->select();
+        bool ok = s != 4;
+        lb->Feedback(s, chrono::milliseconds(s == 2 ? 40 : 2), ok);
+    }
+    for (uint32_t i = 0; i < lb->size(); i++)
+        cout << lb->name(i) << ": latency EWMA " << lb->latencyEwmaMs(i) << " ms, error rate "
+             << lb->errorRate(i) << ", ejected " << lb->ejections(i) << " times" << endl;
+
+    // Simulation: 5 backends of different speed, one of them failing
+    chrono::milliseconds window(argc > 1 ? stoi(argv[1]) : 2000);
+    int clients = argc > 2 ? stoi(argv[2]) : 32;
+    deque<FakeBackend> backends;
+    backends.emplace_back(1.0, 8, 0.0);   // Server I    fast
+    backends.emplace_back(1.0, 8, 0.0);   // Server II   fast
+    backends.emplace_back(5.0, 8, 0.0);   // Server III  slow
+    backends.emplace_back(2.0, 2, 0.0);   // Server IV   saturates early
+    backends.emplace_back(1.0, 8, 0.5);   // Server V    fails half the time
+    cout << endl << clients << " clients, " << window.count() << " ms per policy" << endl;
+    for (Policy policy : {Policy::Random, Policy::PeakEwma}) {
+        lb->setPolicy(policy);
+        lb->reset();
+        SimulationResult r = simulate(lb, backends, clients, window);
+        auto at = [&](double p) {
+            return r.latenciesMs[min(r.latenciesMs.size() - 1, (size_t) (p * (double) r.latenciesMs.size()))];
+        };
+        cout << (policy == Policy::Random ? "random   " : "peak EWMA") << ": " << r.latenciesMs.size()
+             << " requests, p50 " << at(0.5) << " ms, p99 " << at(0.99) << " ms, p99.9 " << at(0.999)
+             << " ms, " << 100.0 * (double) r.failures / (double) r.latenciesMs.size() << "% failed" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : LoadBalancerHashing.cpp
+//============================================================================
+//Variant of SingletonPattern.cpp that sends the same key (session, cache
+//key, ...) to the same server:
+//1. Singleton   (LoadBalancer)
+//		getServer(key) hashes the key; two modes:
+//		Ring - consistent hashing. Every server owns VirtualNodes points on
+//		       a 64-bit ring; a key goes to the first point at or after its
+//		       hash. Lookup is a binary search over the sorted point hashes,
+//		       within the range a table on the top 16 hash bits gives.
+//		       Adding or removing a server only moves the keys between its
+//		       points and their predecessors, about 1/n of all keys.
+//		Jump - Lamping and Veach's jump consistent hash. No table at all and
+//		       O(log n) time, but servers can only be added or removed at
+//		       the end of the list: removing one in the middle would
+//		       renumber the servers after it, so RemoveServer throws.
+//		getServer() without a key still picks at random.
+
+// FNV-1a followed by a 64-bit finalizer, so similar keys spread out.
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+uint64_t hashKey(string_view key) {
+    uint64_t h = 14695981039346656037ull;
+    for (char c : key) h = (h ^ (unsigned char) c) * 1099511628211ull;
+    return mix(h);
+}
+
+int32_t jumpHash(uint64_t key, int32_t buckets) {
+    int64_t b = -1, j = 0;
+    while (j < buckets) {
+        b = j;
+        key = key * 2862933555777941757ull + 1;
+        j = (int64_t) ((double) (b + 1) * ((double) (1ll << 31) / (double) ((key >> 33) + 1)));
+    }
+    return (int32_t) b;
+}
+
+enum class HashMode {Ring, Jump};
+
+//This is the "Singleton" class.
+class LoadBalancer{
+public:
+    static constexpr uint32_t VirtualNodes = 100;
+
+    static LoadBalancer *GetLoadBalancer() {
+        static LoadBalancer instance;
+        return &instance;
+    }
+
+    void setMode(HashMode value) {mode = value;}
+
+    const string &getServer(string_view key) const {return servers[serverFor(hashKey(key))];}
+
+    // Index into the server list; what getServer(key) resolves. Throws
+    // when every server has been removed.
+    uint32_t serverFor(uint64_t hash) const {
+        requireServers();
+        if (mode == HashMode::Jump) return live[jumpHash(hash, (int32_t) live.size())];
+        // the top bits narrow the search to a few points
+        uint64_t b = hash >> (64 - IndexBits);
+        auto first = points.begin() + buckets[b], last = points.begin() + buckets[b + 1];
+        size_t i = lower_bound(first, last, hash) - points.begin();
+        return owners[i == points.size() ? 0 : i];
+    }
+
+    string getServer() const {
+        requireServers();
+        thread_local mt19937 gen(random_device{}());
+        uniform_int_distribution<size_t> distribution(0, live.size() - 1);
+        return servers[live[distribution(gen)]];
+    }
+
+    void AddServer(const string &name) {AddServers(span<const string>(&name, 1));}
+
+    // Adds many servers with a single merge into the ring. Throws, adding
+    // none, if a name is already live or given twice.
+    void AddServers(span<const string> names) {
+        unordered_set<string_view> taken;
+        for (uint32_t s : live) taken.insert(servers[s]);
+        for (const string &name : names)
+            if (!taken.insert(name).second) throw invalid_argument("duplicate server " + name);
+        vector<pair<uint64_t, uint32_t>> added;
+        added.reserve(names.size() * VirtualNodes);
+        for (const string &name : names) {
+            auto index = (uint32_t) servers.size();
+            servers.push_back(name);
+            live.push_back(index);
+            uint64_t base = hashKey(name);
+            for (uint32_t v = 0; v < VirtualNodes; v++)
+                added.emplace_back(mix(base + v * 0x9e3779b97f4a7c15ull), index);
+        }
+        sort(added.begin(), added.end());
+        vector<uint64_t> mergedPoints;
+        vector<uint32_t> mergedOwners;
+        mergedPoints.reserve(points.size() + added.size());
+        mergedOwners.reserve(points.size() + added.size());
+        size_t i = 0, j = 0;
+        while (i < points.size() || j < added.size()) {
+            if (j == added.size() || (i < points.size() && points[i] <= added[j].first)) {
+                mergedPoints.push_back(points[i]);
+                mergedOwners.push_back(owners[i++]);
+            }
+            else {
+                mergedPoints.push_back(added[j].first);
+                mergedOwners.push_back(added[j++].second);
+            }
+        }
+        points = move(mergedPoints);
+        owners = move(mergedOwners);
+        indexRing();
+    }
+
+    // Returns false if no live server has that name. In Jump mode only
+    // the last server can go; removing another throws.
+    bool RemoveServer(const string &name) {
+        auto found = find_if(live.begin(), live.end(), [&](uint32_t s) {return servers[s] == name;});
+        if (found == live.end()) return false;
+        if (mode == HashMode::Jump && found + 1 != live.end())
+            throw invalid_argument("jump hash can only remove the last server, not " + name);
+        uint32_t index = *found;
+        live.erase(found);
+        size_t kept = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            if (owners[i] == index) continue;
+            points[kept] = points[i];
+            owners[kept++] = owners[i];
+        }
+        points.resize(kept);
+        owners.resize(kept);
+        indexRing();
+        return true;
+    }
+
+    size_t size() const {return live.size();}
+    size_t slots() const {return servers.size();} // removed servers keep their index
+    const vector<uint32_t> &liveServers() const {return live;}
+
+private:
+    void requireServers() const {
+        if (live.empty()) throw runtime_error("no live servers");
+    }
+
+    LoadBalancer() {
+        vector<string> names = {"Server I", "Server II", "Server III", "Server IV", "Server V"};
+        AddServers(names);
+    }
+
+    // buckets[b] is the first point whose top IndexBits bits are >= b.
+    void indexRing() {
+        buckets.assign((1u << IndexBits) + 1, (uint32_t) points.size());
+        size_t i = 0;
+        for (uint32_t b = 0; b < (1u << IndexBits); b++) {
+            while (i < points.size() && (points[i] >> (64 - IndexBits)) < b) i++;
+            buckets[b] = (uint32_t) i;
+        }
+    }
+
+    static constexpr uint32_t IndexBits = 16;
+    vector<string> servers;  // by index, including removed ones
+    vector<uint32_t> live;   // indices of current servers, in the order added
+    vector<uint64_t> points; // sorted ring positions
+    vector<uint32_t> owners; // owners[i] owns points[i]
+    vector<uint32_t> buckets;
+    HashMode mode = HashMode::Ring;
+};
+
+int main(int argc, char *argv[]){
+    LoadBalancer *lb = LoadBalancer::GetLoadBalancer();
+
+    // same key, same server
+    for (const char *key : {"session-42", "session-7", "session-42", "cart:ayhan", "session-7"})
+        cout << key << " -> " << lb->getServer(key) << endl;
+    // the ring can lose any server; jump hash only the last one
+    cout << "Removing Server III" << endl;
+    lb->RemoveServer("Server III");
+    for (const char *key : {"session-42", "session-7", "cart:ayhan"})
+        cout << key << " -> " << lb->getServer(key) << endl;
+    lb->setMode(HashMode::Jump);
+    try {
+        lb->RemoveServer("Server I");
+    } catch (const invalid_argument &e) {
+        cout << e.what() << endl;
+    }
+    lb->setMode(HashMode::Ring);
+    try {
+        lb->AddServer("Server II");
+    } catch (const invalid_argument &e) {
+        cout << e.what() << endl;
+    }
+
+    // Benchmark: lookups, balance and key movement at N servers
+    size_t serverCount = argc > 1 ? stoul(argv[1]) : 10000;
+    size_t keyCount = argc > 2 ? stoul(argv[2]) : 1000000;
+    vector<string> names;
+    for (size_t i = lb->slots(); i < serverCount + lb->slots() - lb->size(); i++)
+        names.push_back("backend-" + to_string(i));
+    lb->AddServers(names);
+    vector<string> keys(keyCount);
+    vector<uint64_t> hashes(keyCount);
+    for (size_t i = 0; i < keyCount; i++) {
+        keys[i] = "session-" + to_string(i);
+        hashes[i] = hashKey(keys[i]);
+    }
+
+    cout << endl << lb->size() << " servers, " << keyCount << " keys, " << LoadBalancer::VirtualNodes
+         << " virtual nodes per server on the ring" << endl;
+    for (HashMode mode : {HashMode::Ring, HashMode::Jump}) {
+        lb->setMode(mode);
+        cout << (mode == HashMode::Ring ? "ring" : "jump") << ":" << endl;
+
+        // lookup latency: with hashing the key, and from the hash alone over
+        // shuffled keys so the ring is not walked in order
+        size_t sink = 0;
+        auto start = chrono::steady_clock::now();
+        for (const string &key : keys) sink += lb->getServer(key).size();
+        double keySeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        vector<uint64_t> shuffled = hashes;
+        shuffle(shuffled.begin(), shuffled.end(), mt19937(1));
+        start = chrono::steady_clock::now();
+        for (uint64_t h : shuffled) sink += lb->serverFor(h);
+        double hashSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "  getServer(key): " << keySeconds / (double) keyCount * 1e9 << " ns/lookup, "
+             << "from a precomputed hash: " << hashSeconds / (double) keyCount * 1e9 << " ns"
+             << (sink == 0 ? " " : "") << endl;
+
+        // balance: keys per server relative to the mean
+        vector<uint32_t> before(keyCount);
+        vector<uint32_t> load(lb->slots());
+        for (size_t i = 0; i < keyCount; i++) load[before[i] = lb->serverFor(hashes[i])]++;
+        double mean = (double) keyCount / (double) lb->size(), variance = 0;
+        uint32_t most = 0;
+        for (uint32_t l : load) most = max(most, l);
+        // over every live server, including any that got no keys
+        for (uint32_t s : lb->liveServers()) variance += ((double) load[s] - mean) * ((double) load[s] - mean);
+        cout << "  load: max/mean " << most / mean << ", stddev/mean "
+             << sqrt(variance / (double) lb->size()) / mean << endl;
+
+        // movement when one server joins at the end, then leaves again
+        lb->AddServer("backend-" + to_string(lb->slots()));
+        size_t moved = 0;
+        for (size_t i = 0; i < keyCount; i++) moved += lb->serverFor(hashes[i]) != before[i];
+        cout << "  keys moved by adding 1 server: " << 100.0 * (double) moved / (double) keyCount
+             << "% (ideal " << 100.0 / (double) lb->size() << "%)" << endl;
+        lb->RemoveServer("backend-" + to_string(lb->slots() - 1));
+    }
+}
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : LoadBalancerMembership.cpp
+//============================================================================
+//Variant of SingletonPattern.cpp whose servers can be added, drained and
+//removed while other threads keep calling getServer:
+//1. Singleton   (LoadBalancer)
+//		. Readers pick from an immutable ServerSet snapshot without taking
+//		  any lock.
+//		. AddServer/DrainServer copy the snapshot, change the copy and
+//		  publish it atomically; the old snapshot is freed once no reader
+//		  can still be using it (EpochDomain, as in ObserverRCU.cpp).
+//		. Every server counts its in-flight Requests. A drained server gets
+//		  no new requests; it is deleted by Reap once the snapshots naming
+//		  it are gone and its last request has finished. RemoveServer is
+//		  DrainServer followed by waiting for that.
+
+// xorshift64*, one per thread (see LoadBalancerPolicies.cpp).
+class FastRandom{
+public:
+    FastRandom() {
+        random_device randomDevice;
+        state = ((uint64_t) randomDevice() << 32 | randomDevice()) | 1;
+    }
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+    uint32_t below(uint32_t n) {return (uint32_t) (((next() >> 32) * n) >> 32);}
+private:
+    uint64_t state;
+};
+
+FastRandom &threadRandom() {
+    thread_local FastRandom random;
+    return random;
+}
+
+// Epoch-based reclamation. A reader announces the global epoch in its own
+// slot for the duration of a read; memory retired at epoch E may be freed
+// once every announced epoch is either 0 (idle) or at least E.
+class EpochDomain{
+public:
+    static constexpr size_t MaxThreads = 256;
+
+    // Marks the calling thread as reading for its lifetime.
+    class ReadGuard{
+    public:
+        ReadGuard() : slot(EpochDomain::slot()) {
+            outermost = slot.load(memory_order_relaxed) == 0;
+            if (outermost) slot.store(global.load(), memory_order_seq_cst);
+        }
+        ~ReadGuard() {
+            if (outermost) slot.store(0, memory_order_release);
+        }
+    private:
+        atomic<uint64_t> &slot;
+        bool outermost;
+    };
+
+    // Starts a new epoch and returns it. Call after unpublishing memory.
+    static uint64_t advance() {return global.fetch_add(1, memory_order_seq_cst) + 1;}
+
+    // Smallest epoch a reader may still be in, or UINT64_MAX if all idle.
+    static uint64_t oldestReader() {
+        uint64_t oldest = UINT64_MAX;
+        for (size_t i = 0; i < used.load(memory_order_acquire); i++) {
+            uint64_t e = slots[i].epoch.load(memory_order_seq_cst);
+            if (e != 0 && e < oldest) oldest = e;
+        }
+        return oldest;
+    }
+
+private:
+    struct alignas(64) Slot{
+        atomic<uint64_t> epoch{0};
+    };
+
+    static atomic<uint64_t> &slot() {
+        thread_local atomic<uint64_t> &mine = claim();
+        return mine;
+    }
+    // Slots are handed out once per thread and recycled when it exits.
+    static atomic<uint64_t> &claim() {
+        struct Release{
+            size_t index;
+            ~Release() {
+                lock_guard<mutex> guard(lock);
+                freeSlots.push_back(index);
+            }
+        };
+        lock_guard<mutex> guard(lock);
+        size_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            index = used.fetch_add(1);
+            if (index >= MaxThreads) {
+                cerr << "EpochDomain: too many reader threads" << endl;
+                terminate();
+            }
+        }
+        thread_local Release release{index};
+        return slots[index].epoch;
+    }
+
+    static atomic<uint64_t> global;
+    static Slot slots[MaxThreads];
+    static atomic<size_t> used;
+    static mutex lock;
+    static vector<size_t> freeSlots;
+};
+
+// type declarations for static vars
+atomic<uint64_t> EpochDomain::global{1};
+EpochDomain::Slot EpochDomain::slots[EpochDomain::MaxThreads];
+atomic<size_t> EpochDomain::used{0};
+mutex EpochDomain::lock;
+vector<size_t> EpochDomain::freeSlots;
+
+//This is the "Singleton" class.
+class LoadBalancer{
+private:
+    struct alignas(64) Server{
+        explicit Server(string n) : name(move(n)) {}
+        const string name;
+        atomic<uint32_t> inFlight{0};
+    };
+    // One published version of the membership. Never modified once
+    // published; the Servers themselves are shared between versions.
+    struct ServerSet{
+        vector<Server *> servers;
+    };
+
+public:
+    static LoadBalancer *GetLoadBalancer() {
+        static LoadBalancer instance;
+        return &instance;
+    }
+
+    // An in-flight request; its server is not deleted before it ends.
+    class Request{
+    public:
+        explicit Request(Server *server) : _server(server) {}
+        Request(Request &&other) noexcept : _server(exchange(other._server, nullptr)) {}
+        Request &operator=(Request &&other) noexcept {
+            if (this != &other) {
+                end();
+                _server = exchange(other._server, nullptr);
+            }
+            return *this;
+        }
+        ~Request() {end();}
+        explicit operator bool() const {return _server != nullptr;}
+        const string &server() const {return _server->name;}
+    private:
+        void end() {if (_server != nullptr) _server->inFlight.fetch_sub(1, memory_order_release);}
+        Server *_server;
+    };
+
+    // No server when the set is empty.
+    Request beginRequest() {
+        EpochDomain::ReadGuard reading;
+        const ServerSet *set = current.load(memory_order_seq_cst);
+        if (set->servers.empty()) return Request(nullptr);
+        Server *server = set->servers[threadRandom().below((uint32_t) set->servers.size())];
+        // counted while still reading, so a drain that waits for the
+        // snapshot to retire also sees this request
+        server->inFlight.fetch_add(1, memory_order_seq_cst);
+        return Request(server);
+    }
+
+    string getServer() {
+        Request request = beginRequest();
+        return request ? request.server() : string();
+    }
+
+    // Returns false if a server of that name is already a member.
+    bool AddServer(const string &name) {
+        lock_guard<mutex> guard(writer);
+        const ServerSet *set = current.load();
+        for (Server *s : set->servers)
+            if (s->name == name) return false;
+        auto *next = new ServerSet(*set);
+        next->servers.push_back(new Server(name));
+        publish(next);
+        return true;
+    }
+
+    // Stops new requests to the server. Returns false if it is not a member.
+    bool DrainServer(const string &name) {
+        lock_guard<mutex> guard(writer);
+        const ServerSet *set = current.load();
+        auto found = find_if(set->servers.begin(), set->servers.end(),
+                             [&](Server *s) {return s->name == name;});
+        if (found == set->servers.end()) return false;
+        Server *server = *found;
+        auto *next = new ServerSet(*set);
+        next->servers.erase(next->servers.begin() + (found - set->servers.begin()));
+        uint64_t epoch = publish(next); // may free set
+        draining.emplace_back(epoch, server);
+        return true;
+    }
+
+    // Deletes drained servers that have no requests left; returns how many.
+    size_t Reap() {
+        lock_guard<mutex> guard(writer);
+        return reap();
+    }
+
+    // Drains the server and waits until it is deleted.
+    bool RemoveServer(const string &name) {
+        if (!DrainServer(name)) return false;
+        while (true) {
+            {
+                lock_guard<mutex> guard(writer);
+                reap();
+                if (none_of(draining.begin(), draining.end(),
+                            [&](auto &d) {return d.second->name == name;})) return true;
+            }
+            EpochDomain::advance();
+            this_thread::yield();
+        }
+    }
+
+    vector<string> members() {
+        EpochDomain::ReadGuard reading;
+        vector<string> names;
+        for (Server *s : current.load(memory_order_seq_cst)->servers) names.push_back(s->name);
+        return names;
+    }
+
+private:
+    LoadBalancer() {
+        auto *set = new ServerSet();
+        for (const char *name : {"Server I", "Server II", "Server III", "Server IV", "Server V"})
+            set->servers.push_back(new Server(name));
+        current.store(set);
+    }
+
+    // Must hold writer. Returns the epoch after which no reader sees the
+    // old set.
+    uint64_t publish(ServerSet *next) {
+        ServerSet *old = current.exchange(next, memory_order_seq_cst);
+        uint64_t epoch = EpochDomain::advance();
+        retired.emplace_back(epoch, old);
+        reap();
+        return epoch;
+    }
+    // Must hold writer.
+    size_t reap() {
+        uint64_t oldest = EpochDomain::oldestReader();
+        size_t kept = 0;
+        for (auto &r : retired) {
+            if (r.first <= oldest) delete r.second;
+            else retired[kept++] = r;
+        }
+        retired.resize(kept);
+        size_t deleted = 0;
+        kept = 0;
+        for (auto &d : draining) {
+            if (d.first <= oldest && d.second->inFlight.load(memory_order_acquire) == 0) {
+                delete d.second;
+                deleted++;
+            }
+            else draining[kept++] = d;
+        }
+        draining.resize(kept);
+        return deleted;
+    }
+
+    atomic<ServerSet *> current;
+    mutex writer;                                 // serializes membership changes
+    vector<pair<uint64_t, ServerSet *>> retired;  // (epoch, snapshot)
+    vector<pair<uint64_t, Server *>> draining;    // (epoch, drained server)
+};
+
+// The same interface over a vector guarded by one mutex, for comparison.
+class LockedLoadBalancer{
+public:
+    LockedLoadBalancer() {
+        for (const char *name : {"Server I", "Server II", "Server III", "Server IV", "Server V"})
+            servers.emplace_back(name);
+    }
+    string getServer() {
+        lock_guard<mutex> guard(lock);
+        if (servers.empty()) return {};
+        return servers[threadRandom().below((uint32_t) servers.size())];
+    }
+    void AddServer(const string &name) {
+        lock_guard<mutex> guard(lock);
+        servers.push_back(name);
+    }
+    // Nothing to wait for: getServer never holds on to a server.
+    bool DrainServer(const string &name) {
+        lock_guard<mutex> guard(lock);
+        return erase(servers, name) > 0;
+    }
+    size_t Reap() {return 0;}
+private:
+    mutex lock;
+    vector<string> servers;
+};
+
+// getServer calls per second from `readers` threads while one thread
+// adds a server and drains an older one every `churnEvery`; returns
+// (calls/s, changes/s).
+template <typename LB>
+pair<double, double> underChurn(LB &lb, int readers, chrono::milliseconds window, chrono::microseconds churnEvery) {
+    atomic<bool> stop{false};
+    atomic<uint64_t> calls{0}, changes{0};
+    vector<thread> threads;
+    for (int t = 0; t < readers; t++)
+        threads.emplace_back([&] {
+            uint64_t count = 0;
+            size_t sink = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                sink += lb.getServer().size();
+                count++;
+            }
+            calls += count + (sink == 1);
+        });
+    threads.emplace_back([&] {
+        for (uint64_t n = 0; !stop.load(memory_order_relaxed); n++) {
+            lb.AddServer("Extra " + to_string(n));
+            if (n >= 8) lb.DrainServer("Extra " + to_string(n - 8));
+            lb.Reap();
+            changes++;
+            this_thread::sleep_for(churnEvery);
+        }
+    });
+    auto start = chrono::steady_clock::now();
+    this_thread::sleep_for(window);
+    stop = true;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (thread &t : threads) t.join();
+    return {(double) calls / seconds, (double) changes / seconds};
+}
+
+int main(int argc, char *argv[]){
+    LoadBalancer *lb = LoadBalancer::GetLoadBalancer();
+
+    cout << "Generating 5 requests...." << endl;
+    for (int i = 0; i < 5; i++) cout << lb->getServer() << endl;
+
+    cout << "Adding Server VI, draining Server I while a request is open" << endl;
+    lb->AddServer("Server VI");
+    {
+        LoadBalancer::Request open = lb->beginRequest();
+        while (open.server() != "Server I") open = lb->beginRequest();
+        lb->DrainServer("Server I");
+        cout << "reaped while in flight: " << lb->Reap() << endl;
+    }
+    cout << "reaped after the request ended: " << lb->Reap() << endl;
+    for (const string &name : lb->members()) cout << "  " << name << endl;
+
+    // Benchmark: getServer throughput with and without membership churn
+    chrono::milliseconds window(argc > 1 ? stoi(argv[1]) : 300);
+    int readers = argc > 2 ? stoi(argv[2]) : 4;
+    LockedLoadBalancer locked;
+    cout << endl << readers << " reader threads, " << window.count() << " ms per run" << endl;
+    for (auto every : {chrono::microseconds(10000), chrono::microseconds(100), chrono::microseconds(0)}) {
+        auto [rcuCalls, rcuChanges] = underChurn(*lb, readers, window, every);
+        auto [lockedCalls, lockedChanges] = underChurn(locked, readers, window, every);
+        cout << "churn every " << every.count() << " us:" << endl;
+        cout << "  RCU snapshot: " << rcuCalls << " getServer/s, " << rcuChanges << " changes/s" << endl;
+        cout << "  mutex       : " << lockedCalls << " getServer/s, " << lockedChanges << " changes/s" << endl;
+    }
+}
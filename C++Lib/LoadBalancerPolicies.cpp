@@ -0,0 +1,251 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : LoadBalancerPolicies.cpp
+//============================================================================
+//Variant of SingletonPattern.cpp whose getServer can be called millions of
+//times a second from many threads:
+//1. Singleton   (LoadBalancer)
+//		GetLoadBalancer returns the unique instance (a function-local
+//		static, which C++ initialises thread-safely).
+//2. FastRandom
+//		xorshift64* generator, one per thread, seeded once from
+//		random_device. SingletonPattern.cpp builds a random_device and an
+//		mt19937 on every call instead.
+//3. Policy
+//		How getServer picks a server:
+//		Random            - uniform, from the thread's FastRandom.
+//		RoundRobin        - a shared atomic cursor.
+//		WeightedRandom    - by server weight, in O(1) with Vose's alias
+//		                    tables built once.
+//		PowerOfTwo        - the less busy of two random servers.
+//		LeastOutstanding  - the least busy of all servers.
+//		"Busy" is the number of outstanding requests, an atomic counter per
+//		server kept by Request, on its own cache line.
+
+class FastRandom{
+public:
+    FastRandom() {
+        random_device randomDevice;
+        state = ((uint64_t) randomDevice() << 32 | randomDevice()) | 1;
+    }
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+    // Uniform in [0, n), by multiply-shift instead of a division.
+    uint32_t below(uint32_t n) {return (uint32_t) (((next() >> 32) * n) >> 32);}
+private:
+    uint64_t state;
+};
+
+FastRandom &threadRandom() {
+    thread_local FastRandom random;
+    return random;
+}
+
+enum class Policy {Random, RoundRobin, WeightedRandom, PowerOfTwo, LeastOutstanding};
+
+const char *policyName(Policy policy) {
+    switch (policy) {
+        case Policy::Random: return "random";
+        case Policy::RoundRobin: return "round-robin";
+        case Policy::WeightedRandom: return "weighted random";
+        case Policy::PowerOfTwo: return "power of two choices";
+        case Policy::LeastOutstanding: return "least outstanding";
+    }
+    return "?";
+}
+
+//This is the "Singleton" class.
+class LoadBalancer{
+private:
+    struct alignas(64) Server{
+        string name;
+        uint32_t weight = 1;
+        atomic<uint32_t> outstanding{0};
+    };
+
+public:
+    static LoadBalancer *GetLoadBalancer() {
+        static LoadBalancer instance;
+        return &instance;
+    }
+
+    // An in-flight request to one server; counts as outstanding until
+    // destroyed.
+    class Request{
+    public:
+        Request(LoadBalancer *lb, uint32_t index) : _server(&lb->servers[index]), _index(index) {
+            _server->outstanding.fetch_add(1, memory_order_relaxed);
+        }
+        Request(const Request &) = delete;
+        Request &operator=(const Request &) = delete;
+        ~Request() {_server->outstanding.fetch_sub(1, memory_order_relaxed);}
+        uint32_t index() const {return _index;}
+        const string &server() const {return _server->name;}
+    private:
+        Server *_server;
+        uint32_t _index;
+    };
+
+    void setPolicy(Policy value) {policy.store(value, memory_order_relaxed);}
+    Policy getPolicy() const {return policy.load(memory_order_relaxed);}
+
+    // The index of the server the current policy picks.
+    uint32_t select() {
+        auto n = (uint32_t) servers.size();
+        FastRandom &random = threadRandom();
+        switch (getPolicy()) {
+            case Policy::Random:
+                return random.below(n);
+            case Policy::RoundRobin:
+                return (uint32_t) (cursor.fetch_add(1, memory_order_relaxed) % n);
+            case Policy::WeightedRandom: {
+                uint64_t r = random.next();
+                auto i = (uint32_t) (((r >> 32) * n) >> 32);
+                return (uint32_t) r < aliasThreshold[i] ? i : alias[i];
+            }
+            case Policy::PowerOfTwo: {
+                uint32_t a = random.below(n), b = random.below(n);
+                return outstanding(b) < outstanding(a) ? b : a;
+            }
+            case Policy::LeastOutstanding: {
+                // start at a random server so ties are spread out
+                uint32_t best = random.below(n), bestLoad = outstanding(best);
+                for (uint32_t k = 1; k < n && bestLoad > 0; k++) {
+                    uint32_t i = best + k < n ? best + k : best + k - n;
+                    if (outstanding(i) < bestLoad) best = i, bestLoad = outstanding(i);
+                }
+                return best;
+            }
+        }
+        return 0;
+    }
+
+    Request beginRequest() {return {this, select()};}
+
+    const string &getServer() {return servers[select()].name;}
+
+    uint32_t outstanding(uint32_t i) const {return servers[i].outstanding.load(memory_order_relaxed);}
+    size_t size() const {return servers.size();}
+
+private:
+    LoadBalancer() : servers(5) {
+        const char *names[] = {"Server I", "Server II", "Server III", "Server IV", "Server V"};
+        uint32_t weights[] = {4, 2, 2, 1, 1};
+        for (size_t i = 0; i < servers.size(); i++) {
+            servers[i].name = names[i];
+            servers[i].weight = weights[i];
+        }
+        buildAliasTables();
+    }
+
+    // Vose's alias method: slot i is kept with probability
+    // aliasThreshold[i] / 2^32, otherwise alias[i] is used instead.
+    void buildAliasTables() {
+        size_t n = servers.size();
+        double total = 0;
+        for (Server &s : servers) total += s.weight;
+        vector<double> scaled(n);
+        vector<uint32_t> small, large;
+        for (uint32_t i = 0; i < n; i++) {
+            scaled[i] = servers[i].weight * (double) n / total;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+        aliasThreshold.assign(n, UINT32_MAX);
+        alias.resize(n);
+        for (uint32_t i = 0; i < n; i++) alias[i] = i;
+        while (!small.empty() && !large.empty()) {
+            uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            aliasThreshold[s] = (uint32_t) (scaled[s] * 4294967296.0);
+            alias[s] = l;
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+    }
+
+    vector<Server> servers;
+    vector<uint32_t> aliasThreshold, alias;
+    atomic<Policy> policy{Policy::Random};
+    alignas(64) atomic<uint64_t> cursor{0};
+};
+
+// SingletonPattern.cpp's selection, for comparison.
+uint32_t seededPerCall(uint32_t n) {
+    random_device randomDevice;
+    mt19937 gen(randomDevice());
+    uniform_int_distribution<> distribution(0, (int) n - 1);
+    return (uint32_t) distribution(gen);
+}
+
+// Selections per second from `threads` threads for `window`.
+template <typename F>
+double throughput(int threads, chrono::milliseconds window, F select) {
+    atomic<bool> go{false}, stop{false};
+    atomic<uint64_t> total{0};
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([&] {
+            while (!go.load()) this_thread::yield();
+            uint64_t count = 0, sink = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 64; i++) sink += select();
+                count += 64;
+            }
+            total += count + (sink == UINT64_MAX);
+        });
+    auto start = chrono::steady_clock::now();
+    go = true;
+    this_thread::sleep_for(window);
+    stop = true;
+    for (thread &w : workers) w.join();
+    return (double) total / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]){
+    LoadBalancer *lb = LoadBalancer::GetLoadBalancer();
+
+    Policy policies[] = {Policy::Random, Policy::RoundRobin, Policy::WeightedRandom,
+                         Policy::PowerOfTwo, Policy::LeastOutstanding};
+    for (Policy policy : policies) {
+        lb->setPolicy(policy);
+        cout << policyName(policy) << ":";
+        for (int i = 0; i < 8; i++) cout << " <" << lb->getServer() << ">";
+        cout << endl;
+    }
+
+    // Benchmark: selections per second, each one a full Request (so the
+    // outstanding counters are exercised), 1 to 64 threads.
+    chrono::milliseconds window(argc > 1 ? stoi(argv[1]) : 100);
+    cout << endl << "selections/s (" << lb->size() << " servers, " << window.count()
+         << " ms per run)" << endl;
+    cout << "random_device + mt19937 per call, 1 thread: "
+         << throughput(1, window, [&] {return seededPerCall((uint32_t) lb->size());}) << endl;
+    for (Policy policy : policies) {
+        lb->setPolicy(policy);
+        cout << policyName(policy) << ":" << endl;
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            double rate = throughput(threads, window, [&] {
+                LoadBalancer::Request request = lb->beginRequest();
+                return request.index();
+            });
+            cout << "  " << threads << " threads: " << rate << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : LoadBalancerSharded.cpp
+//============================================================================
+//Variant of SingletonPattern.cpp for many threads calling getServer at
+//once. With a round-robin cursor and per-server outstanding counters in the
+//one instance, every call writes the same cache lines from every core.
+//1. Singleton   (LoadBalancer)
+//		. The server table is written once and only read afterwards.
+//		. Everything written per request lives in a Shard: a round-robin
+//		  cursor and one outstanding counter per server, padded to whole
+//		  cache lines. Sharding decides which Shard a thread uses:
+//		  Shared    - one Shard for everybody (the plain singleton).
+//		  PerCpu    - the Shard of the CPU the thread runs on.
+//		  PerThread - a Shard of its own, handed out on first use and
+//		              put on a free list when the thread exits, for the
+//		              next new thread to reuse.
+//		. Totals across shards (outstanding(server), totalOutstanding) are
+//		  summed when asked for, so requests never pay for them.
+//		. A Request remembers the counter it incremented and decrements
+//		  that same one, wherever it ends.
+
+enum class Sharding {Shared, PerCpu, PerThread};
+
+const char *shardingName(Sharding sharding) {
+    switch (sharding) {
+        case Sharding::Shared: return "shared";
+        case Sharding::PerCpu: return "per CPU";
+        case Sharding::PerThread: return "per thread";
+    }
+    return "?";
+}
+
+//This is the "Singleton" class.
+class LoadBalancer{
+public:
+    static constexpr size_t MaxServers = 30;
+
+    static LoadBalancer *GetLoadBalancer() {
+        static LoadBalancer instance;
+        return &instance;
+    }
+
+    class Request{
+    public:
+        Request(const string &server, atomic<uint32_t> &counter) : _server(server), _counter(counter) {
+            _counter.fetch_add(1, memory_order_relaxed);
+        }
+        Request(const Request &) = delete;
+        Request &operator=(const Request &) = delete;
+        ~Request() {_counter.fetch_sub(1, memory_order_relaxed);}
+        const string &server() const {return _server;}
+    private:
+        const string &_server;
+        atomic<uint32_t> &_counter;
+    };
+
+    void setSharding(Sharding value) {sharding.store(value, memory_order_relaxed);}
+
+    // Round robin within the calling thread's shard. Shards start at
+    // different servers, so together they still spread evenly.
+    Request beginRequest() {
+        Shard &shard = myShard();
+        auto i = (size_t) (shard.cursor.fetch_add(1, memory_order_relaxed) % servers.size());
+        return {servers[i], shard.outstanding[i]};
+    }
+
+    const string &getServer() {
+        Shard &shard = myShard();
+        return servers[shard.cursor.fetch_add(1, memory_order_relaxed) % servers.size()];
+    }
+
+    // Global views, summed over all shards on demand.
+    uint64_t outstanding(size_t server) {
+        uint64_t total = 0;
+        forEachShard([&](Shard &s) {total += s.outstanding[server].load(memory_order_relaxed);});
+        return total;
+    }
+    uint64_t totalOutstanding() {
+        uint64_t total = 0;
+        for (size_t i = 0; i < servers.size(); i++) total += outstanding(i);
+        return total;
+    }
+
+    size_t size() const {return servers.size();}
+
+    // Per-thread shards ever created; bounded by the most threads alive at once.
+    size_t threadShardCount() {
+        lock_guard<mutex> guard(threadShardsLock);
+        return threadShards.size();
+    }
+
+private:
+    struct alignas(64) Shard{
+        atomic<uint64_t> cursor{0};
+        atomic<uint32_t> outstanding[MaxServers]{};
+    };
+
+    LoadBalancer() : cpuShards(max(1u, thread::hardware_concurrency())) {
+        for (const char *name : {"Server I", "Server II", "Server III", "Server IV", "Server V"})
+            servers.emplace_back(name);
+        if (servers.size() > MaxServers) throw length_error("more servers than Shard::outstanding holds");
+        for (size_t c = 0; c < cpuShards.size(); c++) cpuShards[c].cursor = c;
+    }
+
+    Shard &myShard() {
+        switch (sharding.load(memory_order_relaxed)) {
+            case Sharding::Shared:
+                return shared;
+            case Sharding::PerCpu: {
+                int cpu = sched_getcpu();
+                return cpuShards[cpu >= 0 ? (size_t) cpu % cpuShards.size() : 0];
+            }
+            case Sharding::PerThread: {
+                thread_local ShardOwner mine;
+                if (mine.shard == nullptr) mine.shard = acquireThreadShard();
+                return *mine.shard;
+            }
+        }
+        return shared;
+    }
+
+    // Gives a thread's shard back when the thread exits. The shard keeps its
+    // counters: Requests begun on it still decrement them, and whoever reuses
+    // it adds to them, so the sums stay right.
+    struct ShardOwner{
+        Shard *shard = nullptr;
+        ~ShardOwner() {if (shard != nullptr) GetLoadBalancer()->releaseThreadShard(shard);}
+    };
+
+    Shard *acquireThreadShard() {
+        lock_guard<mutex> guard(threadShardsLock);
+        if (!freeThreadShards.empty()) {
+            Shard *shard = freeThreadShards.back();
+            freeThreadShards.pop_back();
+            return shard;
+        }
+        Shard *shard = &threadShards.emplace_back();
+        shard->cursor = threadShards.size();
+        return shard;
+    }
+    void releaseThreadShard(Shard *shard) {
+        lock_guard<mutex> guard(threadShardsLock);
+        freeThreadShards.push_back(shard);
+    }
+
+    template <typename F>
+    void forEachShard(F f) {
+        f(shared);
+        for (Shard &s : cpuShards) f(s);
+        lock_guard<mutex> guard(threadShardsLock);
+        for (Shard &s : threadShards) f(s);
+    }
+
+    vector<string> servers; // read-only once constructed
+    atomic<Sharding> sharding{Sharding::PerThread};
+    Shard shared;
+    vector<Shard> cpuShards;
+    mutex threadShardsLock;   // taken by a thread's first request, at its exit and by the global views
+    deque<Shard> threadShards; // a deque keeps addresses stable
+    vector<Shard *> freeThreadShards; // shards of exited threads
+};
+
+// Requests per second from `threads` threads for `window`.
+double throughput(LoadBalancer *lb, int threads, chrono::milliseconds window) {
+    atomic<bool> go{false}, stop{false};
+    atomic<uint64_t> total{0};
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([&] {
+            while (!go.load()) this_thread::yield();
+            uint64_t count = 0;
+            size_t sink = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 64; i++) {
+                    LoadBalancer::Request request = lb->beginRequest();
+                    sink += request.server().size();
+                }
+                count += 64;
+            }
+            total += count + (sink == 1);
+        });
+    auto start = chrono::steady_clock::now();
+    go = true;
+    this_thread::sleep_for(window);
+    stop = true;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (thread &w : workers) w.join();
+    return (double) total / seconds;
+}
+
+int main(int argc, char *argv[]){
+    LoadBalancer *lb = LoadBalancer::GetLoadBalancer();
+
+    cout << "Generating 10 requests, 3 of them kept open...." << endl;
+    vector<LoadBalancer::Request *> open;
+    for (int i = 0; i < 10; i++) {
+        auto *request = new LoadBalancer::Request(lb->beginRequest());
+        cout << request->server() << endl;
+        if (i % 3 == 0 && open.size() < 3) open.push_back(request);
+        else delete request;
+    }
+    cout << "outstanding: " << lb->totalOutstanding() << endl;
+    for (auto *request : open) delete request;
+    cout << "outstanding: " << lb->totalOutstanding() << endl;
+
+    // Benchmark: requests/s per sharding mode, 1 to 64 threads
+    chrono::milliseconds window(argc > 1 ? stoi(argv[1]) : 100);
+    int maxThreads = argc > 2 ? stoi(argv[2]) : 64;
+    cout << endl << thread::hardware_concurrency() << " hardware threads, " << window.count()
+         << " ms per run" << endl;
+    for (Sharding sharding : {Sharding::Shared, Sharding::PerCpu, Sharding::PerThread}) {
+        lb->setSharding(sharding);
+        cout << shardingName(sharding) << ":" << endl;
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+            cout << "  " << threads << " threads: " << throughput(lb, threads, window) << " requests/s" << endl;
+    }
+    cout << "outstanding after the runs: " << lb->totalOutstanding() << ", per-thread shards: "
+         << lb->threadShardCount() << endl;
+    return 0;
+}
@@ -0,0 +1,462 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverAsync.cpp
+//============================================================================
+//Variant of ObserverPattern.cpp in which a slow Investor no longer stalls
+//the price feed:
+//	1. Subject  (Stock)
+//		. Notify either updates the observers itself (as before) or, when an
+//		  AsyncDispatcher is set, hands a PriceUpdate to the dispatcher and
+//		  returns at once.
+//	2. ConcreteSubject  (IBM)
+//	3. Observer  (Investor)
+//		. Gets an Update(const PriceUpdate&) overload: by the time an async
+//		  update is delivered the stock's price may have moved on, so the
+//		  update carries the price it was published with.
+//	4. AsyncDispatcher
+//		. Runs Updates on a pool of worker threads. Every observer has its
+//		  own bounded Mailbox, and at most one worker drains a mailbox at a
+//		  time, so each observer still sees its updates in order.
+//		. Per-observer Policy when the mailbox is full:
+//		    Block      - the publisher waits (backpressure on the feed),
+//		    DropOldest - the oldest queued update is dropped,
+//		    Conflate   - only the latest price per stock is kept, so a
+//		                 lagging observer skips straight to current prices.
+//		. Counts delivered, dropped and conflated updates and how often the
+//		  publisher had to wait.
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+using Clock = chrono::steady_clock;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+// What an observer learns about one price change.
+struct PriceUpdate{
+    Stock *stock;
+    double price;
+    Clock::time_point published;
+};
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+    virtual void Update(const PriceUpdate &update) {Update(update.stock);}
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+    void Update(const PriceUpdate &update) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+// Counters of one observer's mailbox.
+struct MailboxStats{
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;   // DropOldest: updates thrown away
+    uint64_t conflated = 0; // Conflate: updates replaced by a newer price
+    uint64_t blocked = 0;   // Block: times the publisher had to wait
+};
+
+class AsyncDispatcher{
+public:
+    enum Policy {Block, DropOldest, Conflate};
+
+    explicit AsyncDispatcher(int workers) {
+        for (int i = 0; i < workers; i++)
+            _workers.emplace_back([this] {work();});
+    }
+    ~AsyncDispatcher() {
+        {
+            lock_guard<mutex> guard(_lock);
+            _stopping = true;
+        }
+        _ready.notify_all();
+        for (thread &w : _workers) w.join();
+        for (auto &m : _mailboxes) delete m.second;
+    }
+
+    // Sets how updates to observer are queued. Register every observer
+    // before the first update is published; unregistered observers get
+    // Block with a capacity of 1024.
+    void Register(Observer *observer, Policy policy, size_t capacity) {
+        Mailbox *box = mailbox(observer);
+        lock_guard<mutex> guard(box->lock);
+        box->policy = policy;
+        box->capacity = max<size_t>(1, capacity);
+    }
+
+    void Publish(Observer *observer, const PriceUpdate &update) {
+        Mailbox *box = mailbox(observer);
+        unique_lock<mutex> lock(box->lock);
+        switch (box->policy) {
+            case Block:
+                if (box->queue.size() >= box->capacity) {
+                    box->stats.blocked++;
+                    box->space.wait(lock, [&] {return box->queue.size() < box->capacity;});
+                }
+                box->queue.push_back(update);
+                break;
+            case DropOldest:
+                if (box->queue.size() >= box->capacity) {
+                    box->popFront();
+                    box->stats.dropped++;
+                }
+                box->queue.push_back(update);
+                break;
+            case Conflate: {
+                auto [same, added] = box->pending.try_emplace(update.stock, box->popped + box->queue.size());
+                if (!added) {
+                    // keep the original publish time, so latency shows how
+                    // long the stock has been waiting for delivery
+                    box->queue[same->second - box->popped].price = update.price;
+                    box->stats.conflated++;
+                }
+                else {
+                    if (box->queue.size() >= box->capacity) {
+                        box->popFront();
+                        box->stats.dropped++;
+                    }
+                    box->queue.push_back(update);
+                }
+                break;
+            }
+        }
+        if (!box->scheduled) {
+            box->scheduled = true;
+            lock.unlock();
+            schedule(box);
+        }
+    }
+
+    MailboxStats Stats(Observer *observer) {
+        Mailbox *box = mailbox(observer);
+        lock_guard<mutex> guard(box->lock);
+        return box->stats;
+    }
+
+    // Waits until every mailbox is empty.
+    void Drain() {
+        vector<Mailbox *> boxes;
+        {
+            shared_lock<shared_mutex> reading(_mailboxesLock);
+            for (auto &m : _mailboxes) boxes.push_back(m.second);
+        }
+        for (Mailbox *box : boxes) {
+            unique_lock<mutex> lock(box->lock);
+            box->idle.wait(lock, [&] {return !box->scheduled;});
+        }
+    }
+
+private:
+    struct Mailbox{
+        Observer *observer;
+        mutex lock;
+        condition_variable space; // signalled when an update is taken out
+        condition_variable idle;  // signalled when the mailbox runs empty
+        deque<PriceUpdate> queue;
+        Policy policy = Block;
+        size_t capacity = 1024;
+        bool scheduled = false; // queued for, or being drained by, a worker
+        MailboxStats stats;
+        // Conflate: where each stock's queued update is, counted from the
+        // first update ever queued; queue[i] is number popped + i.
+        unordered_map<Stock *, uint64_t> pending;
+        uint64_t popped = 0;
+
+        PriceUpdate popFront() {
+            PriceUpdate update = queue.front();
+            queue.pop_front();
+            if (policy == Conflate) pending.erase(update.stock);
+            popped++;
+            return update;
+        }
+    };
+
+    // Updates delivered before a worker moves on to another mailbox.
+    static constexpr int Quantum = 32;
+
+    // Publishers only share _mailboxesLock; it is taken exclusively only
+    // to add an observer's mailbox.
+    Mailbox *mailbox(Observer *observer) {
+        {
+            shared_lock<shared_mutex> reading(_mailboxesLock);
+            auto found = _mailboxes.find(observer);
+            if (found != _mailboxes.end()) return found->second;
+        }
+        lock_guard<shared_mutex> writing(_mailboxesLock);
+        Mailbox *&box = _mailboxes[observer];
+        if (box == nullptr) {
+            box = new Mailbox();
+            box->observer = observer;
+        }
+        return box;
+    }
+
+    void schedule(Mailbox *box) {
+        {
+            lock_guard<mutex> guard(_lock);
+            _runnable.push_back(box);
+        }
+        _ready.notify_one();
+    }
+
+    void work() {
+        while (true) {
+            Mailbox *box;
+            {
+                unique_lock<mutex> lock(_lock);
+                _ready.wait(lock, [&] {return _stopping || !_runnable.empty();});
+                if (_runnable.empty()) return;
+                box = _runnable.front();
+                _runnable.pop_front();
+            }
+            for (int i = 0; i < Quantum; i++) {
+                PriceUpdate update{};
+                {
+                    lock_guard<mutex> guard(box->lock);
+                    if (box->queue.empty()) break;
+                    update = box->popFront();
+                }
+                box->space.notify_one();
+                box->observer->Update(update);
+                lock_guard<mutex> guard(box->lock);
+                box->stats.delivered++;
+            }
+            unique_lock<mutex> lock(box->lock);
+            if (box->queue.empty()) {
+                box->scheduled = false;
+                lock.unlock();
+                box->idle.notify_all();
+            }
+            else {
+                lock.unlock();
+                schedule(box); // let other mailboxes have a turn
+            }
+        }
+    }
+
+    vector<thread> _workers;
+    mutex _lock; // guards _runnable and _stopping
+    condition_variable _ready;
+    shared_mutex _mailboxesLock; // guards _mailboxes
+    unordered_map<Observer *, Mailbox *> _mailboxes;
+    deque<Mailbox *> _runnable;
+    bool _stopping = false;
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+    }
+    virtual ~Stock() = default;
+
+    //Register the Observers
+    void Attach (Observer *observer){
+        observers.push_back(observer);
+    }
+
+    //Unregister from list of observers
+    void Detach (Observer *observer){
+        observers.erase(remove(observers.begin(), observers.end(), observer), observers.end());
+    }
+
+    // Asynchronous notification from now on; nullptr switches back.
+    void setDispatcher(AsyncDispatcher *dispatcher) {_dispatcher = dispatcher;}
+
+    void Notify() {
+        if (_dispatcher == nullptr) {
+            for (auto & observer : observers){
+                observer->Update(PriceUpdate{this, _price, Clock::now()});
+            }
+            return;
+        }
+        PriceUpdate update{this, _price, Clock::now()};
+        for (auto & observer : observers){
+            _dispatcher->Publish(observer, update);
+        }
+    }
+
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+    vector<Observer *> observers;
+    AsyncDispatcher *_dispatcher = nullptr;
+};
+
+void Investor::Update(Stock *stock) {
+    Update(PriceUpdate{stock, stock->getPrice(), Clock::now()});
+}
+
+void Investor::Update(const PriceUpdate &update) {
+    _stock = update.stock;
+    _stock_price = update.price;
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+// Investor that takes `delay` per update and records delivery latency.
+class TimedInvestor : public Investor {
+public:
+    TimedInvestor(string name, chrono::microseconds delay) : Investor(move(name)) {_delay = delay;}
+    void Update(const PriceUpdate &update) override {
+        Investor::Update(update);
+        if (_delay.count() > 0) this_thread::sleep_for(_delay);
+        latencies.push_back(chrono::duration<double, micro>(Clock::now() - update.published).count());
+    }
+    vector<double> latencies; // microseconds
+private:
+    chrono::microseconds _delay;
+};
+
+double percentile(vector<double> v, double p) {
+    if (v.empty()) return 0;
+    sort(v.begin(), v.end());
+    return v[min(v.size() - 1, (size_t) (p * (double) v.size()))];
+}
+
+//test application
+int main(int argc, char *argv[]){
+    //Create Investors
+    auto *s = new Investor("Ahmet");
+    auto *b = new Investor("Ayhan");
+
+    // Create IBM stock and attach investors
+    IBM *ibm = new IBM("IBM", 120.00);
+    s->setStock(ibm);
+    b->setStock(ibm);
+    ibm->Attach(s);
+    ibm->Attach(b);
+
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.00);
+
+    cout << "Switching to asynchronous notification \n";
+    {
+        AsyncDispatcher dispatcher(2);
+        dispatcher.Register(b, AsyncDispatcher::Conflate, 16);
+        ibm->setDispatcher(&dispatcher);
+        ibm->setPrice(120.50);
+        ibm->setPrice(120.75);
+        dispatcher.Drain();
+        ibm->setDispatcher(nullptr);
+    }
+
+    // Benchmark: 10 stocks, 8 fast and 2 slow (1ms per update) investors.
+    int ticks = argc > 1 ? stoi(argv[1]) : 5000;
+    verbose = false;
+    cout << endl << ticks << " ticks over 10 stocks, 8 fast and 2 slow investors" << endl;
+
+    auto run = [&](const string &name, int workers, AsyncDispatcher::Policy slowPolicy) {
+        vector<IBM *> stocks;
+        for (int i = 0; i < 10; i++) stocks.push_back(new IBM("S" + to_string(i), 100));
+        vector<TimedInvestor *> investors;
+        for (int i = 0; i < 10; i++)
+            investors.push_back(new TimedInvestor("I" + to_string(i), chrono::microseconds(i < 8 ? 0 : 1000)));
+        for (IBM *stock : stocks)
+            for (TimedInvestor *investor : investors) stock->Attach(investor);
+
+        AsyncDispatcher *dispatcher = nullptr;
+        if (workers > 0) {
+            dispatcher = new AsyncDispatcher(workers);
+            for (int i = 0; i < 10; i++)
+                dispatcher->Register(investors[i], i < 8 ? AsyncDispatcher::Block : slowPolicy, 256);
+            for (IBM *stock : stocks) stock->setDispatcher(dispatcher);
+        }
+
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < ticks; t++)
+            stocks[t % 10]->setPrice(100 + (t % 100) * 0.01);
+        double feedSeconds = chrono::duration<double>(Clock::now() - start).count();
+
+        MailboxStats slow;
+        if (dispatcher != nullptr) {
+            dispatcher->Drain();
+            for (int i = 8; i < 10; i++) {
+                MailboxStats st = dispatcher->Stats(investors[i]);
+                slow.delivered += st.delivered;
+                slow.dropped += st.dropped;
+                slow.conflated += st.conflated;
+                slow.blocked += st.blocked;
+            }
+            delete dispatcher;
+        }
+        vector<double> fast, lagging;
+        for (int i = 0; i < 10; i++) {
+            auto &target = i < 8 ? fast : lagging;
+            target.insert(target.end(), investors[i]->latencies.begin(), investors[i]->latencies.end());
+        }
+        cout << name << ": " << ticks / feedSeconds << " ticks/s; fast p50/p99 "
+             << percentile(fast, 0.5) << "/" << percentile(fast, 0.99) << " us; slow p50/p99 "
+             << percentile(lagging, 0.5) << "/" << percentile(lagging, 0.99) << " us" << endl;
+        if (dispatcher != nullptr)
+            cout << "\tslow investors: " << slow.delivered << " delivered, " << slow.dropped
+                 << " dropped, " << slow.conflated << " conflated, publisher blocked "
+                 << slow.blocked << " times" << endl;
+    };
+
+    run("synchronous         ", 0, AsyncDispatcher::Block);
+    run("async, Block        ", 4, AsyncDispatcher::Block);
+    run("async, DropOldest   ", 4, AsyncDispatcher::DropOldest);
+    run("async, Conflate     ", 4, AsyncDispatcher::Conflate);
+}
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverBroker.cpp
+//============================================================================
+//Variant of ObserverPattern.cpp for tens of thousands of stocks and
+//millions of investors, each following many stocks. Stocks no longer own
+//their investor lists; a Broker sits between subjects and observers:
+//	1. Subject  (Stock)
+//		. Notify asks its Broker to publish the change.
+//	2. ConcreteSubject  (IBM)
+//	3. Observer  (Investor)
+//	4. Broker
+//		. Gives every stock and investor a small dense id.
+//		. Keeps an inverted index from stock id to the ids of its
+//		  subscribers in compressed-row form: one offsets array and one
+//		  array of 32-bit investor ids, sorted within each row. A
+//		  subscription costs 4 bytes instead of a pointer plus vector slack.
+//		. Subscribe/Unsubscribe are bulk operations. They are queued and
+//		  applied together by Commit, which merges them into the index in
+//		  one pass; Publish always sees the last committed index.
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+class Broker;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+    }
+    virtual ~Stock() = default;
+
+    void Notify();
+
+    // Set by Broker::AddStock.
+    void setBroker(Broker *broker, uint32_t id) {_broker = broker; _id = id;}
+    uint32_t getId() const {return _id;}
+
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+    Broker *_broker = nullptr;
+    uint32_t _id = 0;
+};
+
+class Broker{
+public:
+    // (stock id, investor id)
+    using Subscription = pair<uint32_t, uint32_t>;
+
+    uint32_t AddStock(Stock *stock) {
+        auto id = (uint32_t) stocks.size();
+        stocks.push_back(stock);
+        offsets.push_back(offsets.back()); // new, empty row
+        stock->setBroker(this, id);
+        return id;
+    }
+
+    uint32_t AddInvestor(Investor *investor) {
+        investors.push_back(investor);
+        return (uint32_t) investors.size() - 1;
+    }
+
+    // Queued until Commit. Duplicates and unknown pairs are ignored then.
+    void Subscribe(span<const Subscription> subscriptions) {
+        added.insert(added.end(), subscriptions.begin(), subscriptions.end());
+    }
+    void Unsubscribe(span<const Subscription> subscriptions) {
+        removed.insert(removed.end(), subscriptions.begin(), subscriptions.end());
+    }
+    // One investor following (or leaving) many stocks.
+    void Subscribe(uint32_t investor, span<const uint32_t> stockIds) {
+        for (uint32_t s : stockIds) added.emplace_back(s, investor);
+    }
+    void Unsubscribe(uint32_t investor, span<const uint32_t> stockIds) {
+        for (uint32_t s : stockIds) removed.emplace_back(s, investor);
+    }
+
+    // Applies the queued changes: every row is merged with its additions
+    // and removals in a single pass over the index.
+    void Commit() {
+        if (added.empty() && removed.empty()) return;
+        sort(added.begin(), added.end());
+        sort(removed.begin(), removed.end());
+
+        vector<uint64_t> newOffsets(offsets.size());
+        vector<uint32_t> newIds;
+        newIds.reserve(ids.size() + added.size());
+        size_t a = 0, r = 0;
+        for (uint32_t s = 0; s < stocks.size(); s++) {
+            newOffsets[s] = newIds.size();
+            size_t i = offsets[s], end = offsets[s + 1];
+            while (true) {
+                bool fromOld = i < end;
+                bool fromAdd = a < added.size() && added[a].first == s;
+                if (!fromOld && !fromAdd) break;
+                uint32_t next;
+                if (fromOld && (!fromAdd || ids[i] <= added[a].second)) {
+                    next = ids[i++];
+                }
+                else {
+                    next = added[a++].second;
+                    if (next >= investors.size()) continue;
+                }
+                while (r < removed.size() && removed[r] < Subscription(s, next)) r++;
+                if (r < removed.size() && removed[r] == Subscription(s, next)) continue;
+                if (newIds.size() > newOffsets[s] && newIds.back() == next) continue;
+                newIds.push_back(next);
+            }
+        }
+        newOffsets.back() = newIds.size();
+        newIds.shrink_to_fit();
+        offsets = move(newOffsets);
+        ids = move(newIds);
+        added.clear();
+        removed.clear();
+    }
+
+    // Updates every investor subscribed to stock, in investor id order.
+    void Publish(Stock *stock) {
+        uint32_t s = stock->getId();
+        const uint32_t *row = ids.data();
+        for (uint64_t i = offsets[s], end = offsets[s + 1]; i < end; i++)
+            investors[row[i]]->Update(stock);
+    }
+
+    size_t subscriberCount(uint32_t stock) const {return offsets[stock + 1] - offsets[stock];}
+    size_t subscriptionCount() const {return ids.size();}
+    // Bytes used by the index itself (not by the investors).
+    size_t indexBytes() const {
+        return ids.capacity() * sizeof(uint32_t) + offsets.capacity() * sizeof(uint64_t)
+               + investors.capacity() * sizeof(Investor *) + stocks.capacity() * sizeof(Stock *);
+    }
+
+private:
+    vector<Stock *> stocks;
+    vector<Investor *> investors;
+    vector<uint64_t> offsets{0}; // row s is ids[offsets[s] .. offsets[s + 1])
+    vector<uint32_t> ids;
+    vector<Subscription> added, removed;
+};
+
+void Stock::Notify() {
+    if (_broker != nullptr) _broker->Publish(this);
+}
+
+void Investor::Update(Stock *stock) {
+    _stock = stock;
+    _stock_price = _stock->getPrice();
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+template <typename F>
+double seconds(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//test application
+int main(int argc, char *argv[]){
+    Broker broker;
+
+    //Create Investors
+    auto *s = new Investor("Ahmet");
+    auto *b = new Investor("Ayhan");
+    uint32_t sid = broker.AddInvestor(s);
+    uint32_t bid = broker.AddInvestor(b);
+
+    // Create two stocks; Ahmet follows both, Ayhan only IBM
+    IBM *ibm = new IBM("IBM", 120.00);
+    IBM *msft = new IBM("MSFT", 300.00);
+    uint32_t stocks[] = {broker.AddStock(ibm), broker.AddStock(msft)};
+    broker.Subscribe(sid, stocks);
+    broker.Subscribe(bid, span<const uint32_t>(stocks, 1));
+    broker.Commit();
+
+    ibm->setPrice(120.10);
+    msft->setPrice(301.00);
+
+    cout << "Removing Ayhan from IBM \n";
+    broker.Unsubscribe(bid, span<const uint32_t>(stocks, 1));
+    broker.Commit();
+    ibm->setPrice(121);
+
+    // Benchmark: 20k stocks, 1M investors following 10 stocks each by
+    // default; popular stocks are followed more (Zipf).
+    size_t investorCount = argc > 1 ? stoul(argv[1]) : 1000000;
+    size_t stockCount = 20000, follows = 10;
+    verbose = false;
+
+    Broker big;
+    vector<IBM> bigStocks;
+    bigStocks.reserve(stockCount);
+    for (size_t i = 0; i < stockCount; i++) bigStocks.emplace_back("S" + to_string(i), 100);
+    for (IBM &stock : bigStocks) big.AddStock(&stock);
+    vector<Investor> bigInvestors;
+    bigInvestors.reserve(investorCount);
+    for (size_t i = 0; i < investorCount; i++) {
+        bigInvestors.emplace_back("I" + to_string(i));
+        big.AddInvestor(&bigInvestors.back());
+    }
+
+    // Zipf(1.0) over stock ids via a precomputed CDF
+    vector<double> cdf(stockCount);
+    double sum = 0;
+    for (size_t k = 0; k < stockCount; k++) cdf[k] = sum += 1.0 / (double) (k + 1);
+    mt19937 gen(1);
+    uniform_real_distribution<double> u(0, sum);
+    auto popularStock = [&] {
+        return (uint32_t) min(stockCount - 1, (size_t) (lower_bound(cdf.begin(), cdf.end(), u(gen)) - cdf.begin()));
+    };
+
+    vector<Broker::Subscription> subscriptions;
+    subscriptions.reserve(investorCount * follows);
+    for (uint32_t i = 0; i < investorCount; i++)
+        for (size_t f = 0; f < follows; f++) subscriptions.emplace_back(popularStock(), i);
+
+    double subscribeSeconds = seconds([&] {
+        big.Subscribe(subscriptions);
+        big.Commit();
+    });
+    cout << endl << big.subscriptionCount() << " subscriptions (" << investorCount << " investors, "
+         << stockCount << " stocks) committed in " << subscribeSeconds << " s" << endl;
+    cout << "index memory: " << (double) big.indexBytes() / (double) big.subscriptionCount()
+         << " bytes/subscription (vector<Investor*> per stock needs >= 8)" << endl;
+
+    // Ticks are drawn with the same popularity, so hot stocks tick more.
+    vector<uint32_t> ticks(2000);
+    for (uint32_t &t : ticks) t = popularStock();
+    size_t deliveries = 0;
+    for (uint32_t t : ticks) deliveries += big.subscriberCount(t);
+    double fanoutSeconds = seconds([&] {
+        for (size_t i = 0; i < ticks.size(); i++)
+            bigStocks[ticks[i]].setPrice(100 + (double) (i % 100) * 0.01);
+    });
+    cout << "fan-out: " << ticks.size() / fanoutSeconds << " ticks/s, "
+         << deliveries / fanoutSeconds << " deliveries/s" << endl;
+
+    // Bulk unsubscribe a tenth of the investors from everything
+    vector<Broker::Subscription> leaving;
+    for (auto &sub : subscriptions)
+        if (sub.second % 10 == 0) leaving.push_back(sub);
+    double unsubscribeSeconds = seconds([&] {
+        big.Unsubscribe(leaving);
+        big.Commit();
+    });
+    cout << "bulk unsubscribe of " << leaving.size() << " pairs: " << unsubscribeSeconds
+         << " s, " << big.subscriptionCount() << " subscriptions left" << endl;
+}
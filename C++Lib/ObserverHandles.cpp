@@ -0,0 +1,311 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverHandles.cpp
+//============================================================================
+//Variant of ObserverPattern.cpp without its dangling pointer: stocks and
+//investors live in a Registry and refer to each other by handle.
+//	1. Subject  (Stock), ConcreteSubject (IBM), Observer, ConcreteObserver
+//	   (Investor) as in ObserverPattern.cpp, but Stock keeps observer
+//	   handles and Investor a stock handle instead of raw pointers.
+//	2. SlotMap
+//		. Vector of slots plus a free list. A Handle is (index, generation);
+//		  removing an object bumps its slot's generation, so an old handle
+//		  no longer matches and get() returns nullptr. The check is one
+//		  compare, with no reference counting on the way.
+//	3. Registry
+//		. Owns every stock and observer in two SlotMaps. Notify skips
+//		  (and drops) observers that have been removed; getStock() returns
+//		  nullptr once the stock is gone.
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+template <typename T>
+struct Handle{
+    uint32_t index = 0;
+    uint32_t generation = 0; // live slots start at generation 1
+    bool operator==(const Handle &) const = default;
+};
+
+template <typename T>
+class SlotMap{
+public:
+    Handle<T> insert(T value) {
+        uint32_t index;
+        if (freeHead != None) {
+            index = freeHead;
+            freeHead = slots[index].nextFree;
+        }
+        else {
+            index = (uint32_t) slots.size();
+            slots.push_back({{}, 1, None});
+        }
+        slots[index].value = move(value);
+        return {index, slots[index].generation};
+    }
+
+    // Invalidates every handle to the slot. Returns false for stale handles.
+    bool erase(Handle<T> h) {
+        if (get(h) == nullptr) return false;
+        Slot &slot = slots[h.index];
+        slot.value = T{};
+        slot.generation++;
+        slot.nextFree = freeHead;
+        freeHead = h.index;
+        return true;
+    }
+
+    T *get(Handle<T> h) {
+        if (h.index >= slots.size() || slots[h.index].generation != h.generation) return nullptr;
+        return &slots[h.index].value;
+    }
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+    struct Slot{
+        T value;
+        uint32_t generation;
+        uint32_t nextFree;
+    };
+    vector<Slot> slots;
+    uint32_t freeHead = None;
+};
+
+using StockHandle = Handle<unique_ptr<Stock>>;
+using ObserverHandle = Handle<unique_ptr<Observer>>;
+
+class Registry{
+public:
+    template <typename T, typename... Args>
+    ObserverHandle addObserver(Args &&... args) {
+        return observers.insert(make_unique<T>(std::forward<Args>(args)...));
+    }
+    template <typename T, typename... Args>
+    StockHandle addStock(Args &&... args);
+
+    void removeObserver(ObserverHandle h) {observers.erase(h);}
+    void removeStock(StockHandle h) {stocks.erase(h);}
+
+    Observer *observer(ObserverHandle h) {
+        unique_ptr<Observer> *o = observers.get(h);
+        return o != nullptr ? o->get() : nullptr;
+    }
+    Stock *stock(StockHandle h) {
+        unique_ptr<Stock> *s = stocks.get(h);
+        return s != nullptr ? s->get() : nullptr;
+    }
+
+private:
+    SlotMap<unique_ptr<Observer>> observers;
+    SlotMap<unique_ptr<Stock>> stocks;
+};
+
+// The one registry of the program.
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    StockHandle _stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    // nullptr once the stock has been removed from the registry
+    Stock* getStock() {return registry().stock(_stock);}
+    void setStock(StockHandle value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+    }
+    virtual ~Stock() = default;
+
+    //Register the Observers
+    void Attach (ObserverHandle observer){
+        observers.push_back(observer);
+    }
+
+    //Unregister from list of observers
+    void Detach (ObserverHandle observer){
+        for (size_t i = 0; i < observers.size(); i++){
+            if (observers[i] == observer) {
+                observers.erase(observers.begin() + (ptrdiff_t) i);
+                return;
+            }
+        }
+    }
+
+    // Observers removed from the registry are skipped and forgotten.
+    void Notify() {
+        Registry &r = registry();
+        size_t kept = 0;
+        for (ObserverHandle h : observers) {
+            Observer *observer = r.observer(h);
+            if (observer == nullptr) continue;
+            observers[kept++] = h;
+            observer->Update(this);
+        }
+        observers.resize(kept);
+    }
+
+    StockHandle getHandle() {return _handle;}
+    void setHandle(StockHandle value) {_handle = value;}
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+    StockHandle _handle{};
+    vector<ObserverHandle> observers;
+};
+
+template <typename T, typename... Args>
+StockHandle Registry::addStock(Args &&... args) {
+    StockHandle h = stocks.insert(make_unique<T>(std::forward<Args>(args)...));
+    stock(h)->setHandle(h);
+    return h;
+}
+
+void Investor::Update(Stock *stock) {
+    _stock = stock->getHandle();
+    _stock_price = stock->getPrice();
+    if (!verbose) return;
+    _stock_name = stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+// Counts notifications; stands in for a cheap real observer.
+class CountingObserver : public Observer {
+public:
+    void Update(Stock *) override {count++;}
+    uint64_t count = 0;
+};
+
+template <typename F>
+double seconds(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//test application
+int main(int argc, char *argv[]){
+    Registry &r = registry();
+
+    //Create Investors
+    ObserverHandle s = r.addObserver<Investor>("Ahmet");
+    ObserverHandle b = r.addObserver<Investor>("Ayhan");
+
+    // Create IBM stock and attach investors
+    StockHandle ibmHandle = r.addStock<IBM>("IBM", 120.00);
+    auto *ibm = static_cast<IBM *>(r.stock(ibmHandle));
+    auto *ahmet = static_cast<Investor *>(r.observer(s));
+    ahmet->setStock(ibmHandle);
+    static_cast<Investor *>(r.observer(b))->setStock(ibmHandle);
+    ibm->Attach(s);
+    ibm->Attach(b);
+
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.00);
+
+    cout << "Removing Ayhan from the registry \n";
+    r.removeObserver(b); // no Detach needed: Notify drops the stale handle
+    ibm->setPrice(122);
+
+    r.removeStock(ibmHandle);
+    ibm = nullptr;
+    // The investor's handle is stale now and says so, instead of dangling.
+    cout << "Ahmet's stock after removal: " << ahmet->getStock() << endl;
+
+    // Benchmark: one stock notifying N observers through raw pointers,
+    // weak_ptr::lock and registry handles.
+    size_t count = argc > 1 ? stoul(argv[1]) : 100000;
+    int ticks = 1000;
+    verbose = false;
+
+    IBM plain("IBM", 100);
+    vector<Observer *> raw;
+    vector<shared_ptr<Observer>> owners;
+    vector<weak_ptr<Observer>> weak;
+    StockHandle handled = r.addStock<IBM>("IBM", 100);
+    for (size_t i = 0; i < count; i++) {
+        owners.push_back(make_shared<CountingObserver>());
+        weak.push_back(owners.back());
+        raw.push_back(owners.back().get());
+        r.stock(handled)->Attach(r.addObserver<CountingObserver>());
+    }
+
+    double rawSeconds = seconds([&] {
+        for (int t = 0; t < ticks; t++)
+            for (Observer *o : raw) o->Update(&plain);
+    });
+    double weakSeconds = seconds([&] {
+        for (int t = 0; t < ticks; t++)
+            for (auto &w : weak)
+                if (shared_ptr<Observer> o = w.lock()) o->Update(&plain);
+    });
+    double handleSeconds = seconds([&] {
+        Stock *stock = r.stock(handled);
+        for (int t = 0; t < ticks; t++) stock->Notify();
+    });
+
+    double updates = (double) count * ticks;
+    cout << endl << count << " observers, " << ticks << " notifications" << endl;
+    cout << "raw pointers   : " << rawSeconds / updates * 1e9 << " ns/update (no staleness check)" << endl;
+    cout << "weak_ptr::lock : " << weakSeconds / updates * 1e9 << " ns/update" << endl;
+    cout << "slot-map handle: " << handleSeconds / updates * 1e9 << " ns/update" << endl;
+}
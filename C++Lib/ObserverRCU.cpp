@@ -0,0 +1,413 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverRCU.cpp
+//============================================================================
+//Variant of ObserverPattern.cpp in which observers may be attached and
+//detached from any thread, even while the subject is notifying:
+//	1. Subject  (Stock)
+//		. Keeps its observers in an immutable Subscribers snapshot. Notify
+//		  reads the current snapshot without taking any lock.
+//		. Attach/Detach copy the snapshot, change the copy and publish it
+//		  atomically. The old snapshot is freed once no Notify can still be
+//		  reading it (epoch-based reclamation, see EpochDomain).
+//		. Attach returns a Subscription handle (id, generation); Detach finds
+//		  the observer's position through the handle instead of comparing
+//		  names. Detaching bumps the id's generation, so a stale or repeated
+//		  Detach with the old handle does nothing, even once the id is reused.
+//	2. ConcreteSubject  (IBM)
+//	3. Observer  (Investor)
+//	4. ConcreteObserver  (Investor)
+//
+//Detach only stops future notifications. A Notify that started earlier may
+//still call the observer; call Stock::Synchronize() before deleting it.
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+// Epoch-based reclamation. A reader announces the global epoch in its own
+// slot for the duration of a read; memory retired at epoch E may be freed
+// once every announced epoch is either 0 (idle) or at least E.
+class EpochDomain{
+public:
+    static constexpr size_t MaxThreads = 256;
+
+    // Marks the calling thread as reading for its lifetime. Guards may
+    // nest (an observer notifying another stock); the outermost one counts.
+    class ReadGuard{
+    public:
+        ReadGuard() : slot(EpochDomain::slot()) {
+            outermost = slot.load(memory_order_relaxed) == 0;
+            if (outermost) slot.store(global.load(), memory_order_seq_cst);
+        }
+        ~ReadGuard() {
+            if (outermost) slot.store(0, memory_order_release);
+        }
+    private:
+        atomic<uint64_t> &slot;
+        bool outermost;
+    };
+
+    // Starts a new epoch and returns it. Call after unpublishing memory.
+    static uint64_t advance() {return global.fetch_add(1, memory_order_seq_cst) + 1;}
+
+    // Smallest epoch a reader may still be in, or UINT64_MAX if all idle.
+    static uint64_t oldestReader() {
+        uint64_t oldest = UINT64_MAX;
+        for (size_t i = 0; i < used.load(memory_order_acquire); i++) {
+            uint64_t e = slots[i].epoch.load(memory_order_seq_cst);
+            if (e != 0 && e < oldest) oldest = e;
+        }
+        return oldest;
+    }
+
+private:
+    struct alignas(64) Slot{
+        atomic<uint64_t> epoch{0};
+    };
+
+    static atomic<uint64_t> &slot() {
+        thread_local atomic<uint64_t> &mine = claim();
+        return mine;
+    }
+    // Slots are handed out once per thread and recycled when it exits.
+    static atomic<uint64_t> &claim() {
+        struct Release{
+            size_t index;
+            ~Release() {
+                lock_guard<mutex> guard(lock);
+                freeSlots.push_back(index);
+            }
+        };
+        lock_guard<mutex> guard(lock);
+        size_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            index = used.fetch_add(1);
+            if (index >= MaxThreads) {
+                cerr << "EpochDomain: too many reader threads" << endl;
+                terminate();
+            }
+        }
+        thread_local Release release{index};
+        return slots[index].epoch;
+    }
+
+    static atomic<uint64_t> global;
+    static Slot slots[MaxThreads];
+    static atomic<size_t> used;
+    static mutex lock;
+    static vector<size_t> freeSlots;
+};
+
+// type declarations for static vars
+atomic<uint64_t> EpochDomain::global{1};
+EpochDomain::Slot EpochDomain::slots[EpochDomain::MaxThreads];
+atomic<size_t> EpochDomain::used{0};
+mutex EpochDomain::lock;
+vector<size_t> EpochDomain::freeSlots;
+
+// Handle returned by Stock::Attach, used to Detach in O(1).
+struct Subscription{
+    uint32_t id = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+        _subscribers.store(new Subscribers());
+    }
+    virtual ~Stock() {
+        delete _subscribers.load();
+        for (auto &r : _retired) delete r.second;
+    }
+
+    //Register the Observers
+    Subscription Attach (Observer *observer){
+        lock_guard<mutex> guard(_writer);
+        Subscription handle;
+        if (!_freeIds.empty()) {
+            handle.id = _freeIds.back();
+            _freeIds.pop_back();
+        }
+        else {
+            handle.id = (uint32_t) _positions.size();
+            _positions.push_back(0);
+            _generations.push_back(1);
+        }
+        handle.generation = _generations[handle.id];
+        auto *next = new Subscribers(*_subscribers.load());
+        _positions[handle.id] = (uint32_t) next->observers.size();
+        next->observers.push_back(observer);
+        next->ids.push_back(handle.id);
+        publish(next);
+        return handle;
+    }
+
+    //Unregister from list of observers. The observer that was last in the
+    //list takes the removed one's place, so no other entry has to move.
+    //Returns false, changing nothing, for a handle that is no longer attached.
+    bool Detach (Subscription handle){
+        lock_guard<mutex> guard(_writer);
+        if (handle.id >= _positions.size() || _generations[handle.id] != handle.generation) return false;
+        auto *next = new Subscribers(*_subscribers.load());
+        uint32_t at = _positions[handle.id];
+        next->observers[at] = next->observers.back();
+        next->ids[at] = next->ids.back();
+        _positions[next->ids[at]] = at;
+        next->observers.pop_back();
+        next->ids.pop_back();
+        _positions[handle.id] = UINT32_MAX;
+        _generations[handle.id]++;
+        _freeIds.push_back(handle.id);
+        publish(next);
+        return true;
+    }
+
+    void Notify() {
+        EpochDomain::ReadGuard reading;
+        const Subscribers *current = _subscribers.load(memory_order_seq_cst);
+        for (Observer *observer : current->observers){
+            observer->Update(this);
+        }
+    }
+
+    // Waits until every Notify that might still see a detached observer has
+    // finished.
+    void Synchronize() {
+        uint64_t epoch = EpochDomain::advance();
+        while (EpochDomain::oldestReader() < epoch)
+            this_thread::yield();
+        lock_guard<mutex> guard(_writer);
+        reclaim();
+    }
+
+    size_t observerCount() const {return _subscribers.load()->observers.size();}
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+
+private:
+    // One published version of the observer list. Never modified once
+    // published.
+    struct Subscribers{
+        vector<Observer *> observers;
+        vector<uint32_t> ids; // ids[i] is the subscription of observers[i]
+    };
+
+    // Must hold _writer.
+    void publish(Subscribers *next) {
+        Subscribers *old = _subscribers.exchange(next, memory_order_seq_cst);
+        _retired.emplace_back(EpochDomain::advance(), old);
+        reclaim();
+    }
+    // Must hold _writer.
+    void reclaim() {
+        uint64_t oldest = EpochDomain::oldestReader();
+        size_t kept = 0;
+        for (auto &r : _retired) {
+            if (r.first <= oldest) delete r.second;
+            else _retired[kept++] = r;
+        }
+        _retired.resize(kept);
+    }
+
+    atomic<Subscribers *> _subscribers;
+    mutex _writer;                            // serializes Attach/Detach
+    vector<uint32_t> _positions;              // subscription id -> index
+    vector<uint32_t> _generations;            // subscription id -> current generation
+    vector<uint32_t> _freeIds;
+    vector<pair<uint64_t, Subscribers *>> _retired; // (epoch, snapshot)
+};
+
+void Investor::Update(Stock *stock) {
+    _stock = stock;
+    _stock_price = _stock->getPrice();
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+// The ObserverPattern.cpp subject, made thread safe the simple way: one
+// mutex around the investor list, held during the whole notification.
+class LockedStock{
+public:
+    void Attach(Observer *observer) {
+        lock_guard<mutex> guard(lock);
+        observers.push_back(observer);
+    }
+    void Detach(Observer *observer) {
+        lock_guard<mutex> guard(lock);
+        for (size_t i = 0; i < observers.size(); i++) {
+            if (observers[i] == observer) {
+                observers.erase(observers.begin() + (long) i);
+                return;
+            }
+        }
+    }
+    void Notify(Stock *stock) {
+        lock_guard<mutex> guard(lock);
+        for (Observer *observer : observers) observer->Update(stock);
+    }
+private:
+    mutex lock;
+    vector<Observer *> observers;
+};
+
+// Counts notifications; stands in for a cheap real observer.
+class CountingObserver : public Observer {
+public:
+    void Update(Stock *) override {count++;}
+    uint64_t count = 0;
+};
+
+//test application
+int main(int argc, char *argv[]){
+    //Create Investors
+    auto *s = new Investor("Ahmet");
+    auto *b = new Investor("Ayhan");
+
+    // Create IBM stock and attach investors
+    IBM *ibm = new IBM("IBM", 120.00);
+    s->setStock(ibm);
+    b->setStock(ibm);
+    Subscription sub_s = ibm->Attach(s);
+    Subscription sub_b = ibm->Attach(b);
+
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.00);
+
+    cout << "Removing Ayhan from notification list \n";
+    ibm->Detach(sub_b);
+    ibm->Synchronize(); // no Notify can still reach Ayhan from here on
+    delete b;
+    ibm->setPrice(121);
+    ibm->setPrice(122);
+    // Ayhan's id is free and goes to the next Attach; a repeated Detach with
+    // Ayhan's old handle must not remove Ceren
+    auto *c = new Investor("Ceren");
+    c->setStock(ibm);
+    Subscription sub_c = ibm->Attach(c);
+    cout << "Detach with a stale handle: " << (ibm->Detach(sub_b) ? "removed" : "ignored")
+         << ", " << ibm->observerCount() << " observers left" << endl;
+    ibm->Detach(sub_c);
+    ibm->Detach(sub_s);
+
+    // Benchmark: one feed thread notifying 1000 observers while churn
+    // threads keep attaching and detaching 100 more.
+    int seconds = argc > 1 ? stoi(argv[1]) : 2;
+    int churners = 2;
+    verbose = false;
+    vector<CountingObserver> stable(1000), churning(100 * churners);
+
+    auto run = [&](auto notify, auto attach, auto detach) {
+        atomic<bool> stop{false};
+        atomic<uint64_t> churnOps{0};
+        vector<thread> threads;
+        for (int c = 0; c < churners; c++) {
+            threads.emplace_back([&, c] {
+                while (!stop.load(memory_order_relaxed)) {
+                    for (int i = 0; i < 100; i++) {
+                        auto handle = attach(&churning[c * 100 + i]);
+                        detach(handle, &churning[c * 100 + i]);
+                        churnOps += 2;
+                    }
+                }
+            });
+        }
+        uint64_t notifies = 0;
+        auto start = chrono::steady_clock::now();
+        while (chrono::steady_clock::now() - start < chrono::seconds(seconds)) {
+            for (int i = 0; i < 100; i++) notify();
+            notifies += 100;
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        stop = true;
+        for (thread &t : threads) t.join();
+        cout << "\t" << notifies / elapsed << " notifies/s, " << churnOps / elapsed << " attach+detach/s" << endl;
+    };
+
+    cout << endl << "Notify throughput with " << stable.size() << " observers and "
+         << churners << " churn threads" << endl;
+
+    cout << "mutex-protected vector:" << endl;
+    LockedStock locked;
+    for (CountingObserver &o : stable) locked.Attach(&o);
+    run([&] {locked.Notify(ibm);},
+        [&](Observer *o) {locked.Attach(o); return 0;},
+        [&](int, Observer *o) {locked.Detach(o);});
+
+    cout << "RCU snapshot:" << endl;
+    IBM rcu("IBM", 120.00);
+    for (CountingObserver &o : stable) rcu.Attach(&o);
+    run([&] {rcu.Notify();},
+        [&](Observer *o) {return rcu.Attach(o);},
+        [&](Subscription handle, Observer *) {rcu.Detach(handle);});
+}
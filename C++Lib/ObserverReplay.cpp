@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverReplay.cpp
+//============================================================================
+//Drives the classes of ObserverPattern.cpp from a recorded tick file instead
+//of hand-written setPrice calls:
+//	1. Subject  (Stock), ConcreteSubject (IBM), Observer, ConcreteObserver
+//	   (Investor) as in ObserverPattern.cpp.
+//	2. TickFile
+//		. Memory-maps a binary tick file: a TickHeader, one 8-byte name per
+//		  symbol, then 16-byte Tick records (timestamp, symbol id, price in
+//		  1/10000 units) in time order.
+//	3. Replayer
+//		. Calls setPrice on the stock of every tick, either as fast as it
+//		  can or paced by the recorded timestamps (optionally sped up),
+//		  and records notifications and a latency histogram per tick.
+//	4. writeSyntheticTicks
+//		. Streams a random-walk tick file of any size to disk.
+//
+//Usage:  ObserverReplay                          demo on a small temp file
+//        ObserverReplay generate FILE TICKS SYMBOLS
+//        ObserverReplay replay FILE [SPEED]      SPEED 0 = as fast as possible
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+// When false, investors are updated silently. The replay turns it off.
+static bool verbose = true;
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+    uint64_t updates = 0;
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+    }
+    virtual ~Stock() = default;
+
+    //Register the Observers
+    void Attach (Investor *investor){
+        investors.push_back(investor);
+    }
+
+    void Notify() {
+        for (auto & investor : investors){
+            investor->Update(this);
+        }
+    }
+
+    size_t observerCount() const {return investors.size();}
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+    vector<Investor *> investors;
+};
+
+void Investor::Update(Stock *stock) {
+    _stock = stock;
+    _stock_price = _stock->getPrice();
+    updates++;
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+// On-disk layout. All fields are little-endian, as written by this program.
+struct TickHeader{
+    char magic[8];        // "TICKS01\0"
+    uint32_t symbolCount;
+    uint32_t reserved;
+    uint64_t tickCount;
+    uint64_t reserved2;
+};
+struct Tick{
+    uint64_t timestampNs; // since the start of the recording
+    uint32_t symbol;      // index into the symbol names
+    uint32_t price;       // in 1/10000 of a currency unit
+};
+static_assert(sizeof(TickHeader) == 32 && sizeof(Tick) == 16);
+static const char TickMagic[8] = "TICKS01";
+static constexpr double PriceScale = 10000.0;
+// Names are "S<n>" in 8 bytes, so S0 .. S9999999.
+static constexpr uint32_t MaxSymbols = 10000000;
+
+// Read-only memory mapping of a tick file.
+class TickFile{
+public:
+    explicit TickFile(const string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("cannot open " + path);
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw runtime_error("cannot stat " + path);
+        }
+        _size = (size_t) st.st_size;
+        if (_size < sizeof(TickHeader)) {
+            close(fd);
+            throw runtime_error(path + " is not a tick file");
+        }
+        _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (_data == MAP_FAILED) throw runtime_error("cannot map " + path);
+        madvise(_data, _size, MADV_SEQUENTIAL);
+
+        auto *header = static_cast<const TickHeader *>(_data);
+        size_t ticksAt = sizeof(TickHeader) + (size_t) header->symbolCount * 8;
+        if (memcmp(header->magic, TickMagic, 8) != 0
+            || ticksAt > _size || header->tickCount > (_size - ticksAt) / sizeof(Tick)) {
+            munmap(_data, _size);
+            throw runtime_error(path + " is not a tick file or is truncated");
+        }
+        auto *bytes = static_cast<const char *>(_data);
+        for (uint32_t s = 0; s < header->symbolCount; s++)
+            _symbols.emplace_back(bytes + sizeof(TickHeader) + s * 8, strnlen(bytes + sizeof(TickHeader) + s * 8, 8));
+        _ticks = span<const Tick>(reinterpret_cast<const Tick *>(bytes + ticksAt), header->tickCount);
+    }
+    ~TickFile() {munmap(_data, _size);}
+    TickFile(const TickFile &) = delete;
+    TickFile &operator=(const TickFile &) = delete;
+
+    const vector<string> &symbols() const {return _symbols;}
+    span<const Tick> ticks() const {return _ticks;}
+
+private:
+    void *_data;
+    size_t _size;
+    vector<string> _symbols;
+    span<const Tick> _ticks;
+};
+
+// Power-of-two buckets of nanoseconds: bucket b holds [2^b, 2^(b+1)).
+class LatencyHistogram{
+public:
+    void record(uint64_t ns) {
+        int b = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+        buckets[b]++;
+        count++;
+        maxNs = max(maxNs, ns);
+    }
+    // Upper bound of the bucket holding the p-th quantile.
+    uint64_t quantile(double p) const {
+        auto target = (uint64_t) ceil(p * (double) count);
+        uint64_t seen = 0;
+        for (int b = 0; b < 64; b++) {
+            seen += buckets[b];
+            if (seen >= target && seen > 0) return min<uint64_t>(maxNs, b == 63 ? UINT64_MAX : (2ull << b) - 1);
+        }
+        return maxNs;
+    }
+    void print(const string &name) const {
+        cout << name << " p50 <= " << quantile(0.5) << " ns, p99 <= " << quantile(0.99)
+             << " ns, p99.9 <= " << quantile(0.999) << " ns, max " << maxNs << " ns" << endl;
+    }
+private:
+    uint64_t buckets[64] = {};
+    uint64_t count = 0;
+    uint64_t maxNs = 0;
+};
+
+class Replayer{
+public:
+    // One IBM per symbol of the file, with investorsPerStock investors each.
+    Replayer(const TickFile &file, int investorsPerStock) : _file(file) {
+        for (const string &name : file.symbols()) {
+            _stocks.push_back(new IBM(name, 0));
+            for (int i = 0; i < investorsPerStock; i++) {
+                _investors.push_back(new Investor(name + "-investor" + to_string(i)));
+                _stocks.back()->Attach(_investors.back());
+            }
+        }
+    }
+    ~Replayer() {
+        for (Investor *i : _investors) delete i;
+        for (IBM *s : _stocks) delete s;
+    }
+
+    // speed 0 replays as fast as possible; otherwise ticks are released at
+    // their recorded time divided by speed. Lateness is how far behind that
+    // schedule the replay was when a tick was released.
+    void run(double speed) {
+        using Clock = chrono::steady_clock;
+        span<const Tick> ticks = _file.ticks();
+        uint64_t before = notifications();
+        _latency = {};
+        _lateness = {};
+        Clock::time_point start = Clock::now();
+        for (const Tick &tick : ticks) {
+            if (speed > 0) {
+                auto due = start + chrono::nanoseconds((uint64_t) ((double) tick.timestampNs / speed));
+                Clock::time_point now = Clock::now();
+                if (now < due) {
+                    this_thread::sleep_until(due);
+                    _lateness.record(0); // on time
+                }
+                else _lateness.record((uint64_t) chrono::nanoseconds(now - due).count());
+            }
+            if (tick.symbol >= _stocks.size()) throw runtime_error("tick for unknown symbol");
+            Clock::time_point t0 = Clock::now();
+            _stocks[tick.symbol]->setPrice(tick.price / PriceScale);
+            _latency.record((uint64_t) chrono::nanoseconds(Clock::now() - t0).count());
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+        cout << ticks.size() << " ticks in " << seconds << " s: " << ticks.size() / seconds
+             << " ticks/s, " << notifications() - before << " notifications" << endl;
+        _latency.print("setPrice latency:");
+        if (speed > 0) _lateness.print("lateness        :");
+    }
+
+private:
+    uint64_t notifications() const {
+        uint64_t n = 0;
+        for (Investor *i : _investors) n += i->updates;
+        return n;
+    }
+
+    const TickFile &_file;
+    vector<IBM *> _stocks;
+    vector<Investor *> _investors;
+    LatencyHistogram _latency, _lateness;
+};
+
+// A failed fwrite sets the stream's error flag, which fclose does not
+// report; check it first.
+void finishWrite(FILE *out, const string &path) {
+    bool failed = fflush(out) != 0 || ferror(out) != 0;
+    if (fclose(out) != 0 || failed) throw runtime_error("short write to " + path);
+}
+
+// Writes `ticks` random-walk ticks over `symbols` symbols, streaming in
+// chunks so files larger than memory are fine.
+void writeSyntheticTicks(const string &path, uint64_t ticks, uint32_t symbols) {
+    if (symbols == 0 || symbols > MaxSymbols) throw invalid_argument("need 1 to 10000000 symbols");
+    FILE *out = fopen(path.c_str(), "wb");
+    if (out == nullptr) throw runtime_error("cannot create " + path);
+    TickHeader header{};
+    memcpy(header.magic, TickMagic, 8);
+    header.symbolCount = symbols;
+    header.tickCount = ticks;
+    fwrite(&header, sizeof header, 1, out);
+    for (uint32_t s = 0; s < symbols; s++) {
+        char name[16] = {}; // only the first 8 bytes are stored; MaxSymbols keeps names within them
+        snprintf(name, sizeof name, "S%u", s);
+        fwrite(name, 8, 1, out);
+    }
+
+    mt19937_64 gen(11);
+    uniform_int_distribution<uint32_t> symbol(0, symbols - 1);
+    exponential_distribution<double> gap(1.0 / 1000.0); // a tick every ~1us
+    normal_distribution<double> step(0, 0.0005);
+    vector<double> prices(symbols, 100.0);
+    vector<Tick> chunk;
+    chunk.reserve(1 << 16);
+    double now = 0;
+    for (uint64_t i = 0; i < ticks; i++) {
+        uint32_t s = symbol(gen);
+        prices[s] = max(0.01, prices[s] * (1 + step(gen)));
+        now += gap(gen);
+        chunk.push_back({(uint64_t) now, s, (uint32_t) llround(prices[s] * PriceScale)});
+        if (chunk.size() == chunk.capacity() || i + 1 == ticks) {
+            if (fwrite(chunk.data(), sizeof(Tick), chunk.size(), out) != chunk.size()) {
+                fclose(out);
+                throw runtime_error("short write to " + path);
+            }
+            chunk.clear();
+        }
+    }
+    finishWrite(out, path);
+}
+
+//test application
+int main(int argc, char *argv[]){
+    try {
+        if (argc >= 5 && string(argv[1]) == "generate") {
+            unsigned long symbols = stoul(argv[4]);
+            if (symbols == 0 || symbols > MaxSymbols) throw invalid_argument("SYMBOLS must be 1 to 10000000");
+            writeSyntheticTicks(argv[2], stoull(argv[3]), (uint32_t) symbols);
+            return 0;
+        }
+        if (argc >= 3 && string(argv[1]) == "replay") {
+            verbose = false;
+            TickFile file(argv[2]);
+            Replayer replayer(file, 4);
+            replayer.run(argc > 3 ? stod(argv[3]) : 0);
+            return 0;
+        }
+
+        // Demo: a few ticks with narration, then a million without
+        string path = "/tmp/ObserverReplay.ticks";
+        writeSyntheticTicks(path, 3, 1);
+        {
+            TickFile file(path);
+            Replayer replayer(file, 2);
+            replayer.run(0);
+        }
+        verbose = false;
+        writeSyntheticTicks(path, 1000000, 100);
+        TickFile file(path);
+        Replayer replayer(file, 4);
+        cout << endl << "As fast as possible:" << endl;
+        replayer.run(0);
+        cout << endl << "At recorded pace:" << endl;
+        replayer.run(1);
+        unlink(path.c_str());
+    }
+    catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
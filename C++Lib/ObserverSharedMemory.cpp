@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverSharedMemory.cpp
+//============================================================================
+//Carries ObserverPattern.cpp's notifications to other processes on the same
+//machine through a ring buffer in POSIX shared memory:
+//	1. Subject  (Stock), ConcreteSubject (IBM), Observer, ConcreteObserver
+//	   (Investor) as in ObserverPattern.cpp.
+//	2. PriceRing
+//		. A single-producer, multi-consumer ring of PriceSlots in a
+//		  shm_open'ed segment. Every update gets a sequence number. The
+//		  producer never waits for consumers; a consumer that falls more
+//		  than a ring's length behind notices (overrun) and skips ahead.
+//	3. RingPublisher  (an Observer in the producer process)
+//		. Attached to stocks like any Investor; every Update is written to
+//		  the ring.
+//	4. RingSubscriber  (the consumer side)
+//		. Keeps a local mirror IBM per symbol and calls setPrice on it for
+//		  every update read from the ring, so local Investors attached to
+//		  the mirrors get their Update calls as usual.
+//
+//Each slot is guarded by its own sequence word: the producer marks the slot
+//busy, writes the fields and then stores the slot's sequence number + 1; a
+//reader copies the fields and re-reads the word to make sure it did not
+//change underneath. All shared fields are lock-free atomics, so the
+//segment can be mapped by unrelated processes.
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+    }
+    virtual ~Stock() = default;
+
+    //Register the Observers
+    void Attach (Observer *observer){
+        observers.push_back(observer);
+    }
+
+    void Notify() {
+        for (auto & observer : observers){
+            observer->Update(this);
+        }
+    }
+
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+    vector<Observer *> observers;
+};
+
+void Investor::Update(Stock *stock) {
+    _stock = stock;
+    _stock_price = _stock->getPrice();
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "[pid " << getpid() << "] Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+// CLOCK_MONOTONIC is shared by all processes on the machine.
+uint64_t monotonicNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+// One price update as read from the ring.
+struct PriceUpdate{
+    uint64_t sequence;
+    char symbol[8];      // not NUL-terminated when 8 characters long
+    double price;
+    uint64_t publishedNs; // monotonicNs() at publication
+};
+
+class PriceRing{
+public:
+    static_assert(atomic<uint64_t>::is_always_lock_free, "shared memory needs lock-free atomics");
+
+    // Creates (or replaces) the segment. capacity must be a power of two.
+    static PriceRing create(const string &name, uint64_t capacity) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+            throw invalid_argument("ring capacity must be a power of two");
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw runtime_error("shm_open failed for " + name);
+        size_t bytes = sizeof(Header) + capacity * sizeof(Slot);
+        if (ftruncate(fd, (off_t) bytes) != 0) {
+            close(fd);
+            throw runtime_error("ftruncate failed for " + name);
+        }
+        PriceRing ring(fd, bytes);
+        // The segment starts zeroed: sequence words of 0 mean "never written".
+        ring._header->capacity = capacity;
+        ring._header->magic.store(Magic, memory_order_release);
+        return ring;
+    }
+
+    static PriceRing open(const string &name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) throw runtime_error("no price ring named " + name);
+        Header header{};
+        if (pread(fd, &header, sizeof header, 0) != (ssize_t) sizeof header || header.magic != Magic) {
+            close(fd);
+            throw runtime_error(name + " is not an initialised price ring");
+        }
+        return PriceRing(fd, sizeof(Header) + header.capacity * sizeof(Slot));
+    }
+
+    static void remove(const string &name) {shm_unlink(name.c_str());}
+
+    PriceRing(PriceRing &&other) noexcept : _header(other._header), _slots(other._slots), _bytes(other._bytes) {
+        other._header = nullptr;
+    }
+    ~PriceRing() {if (_header != nullptr) munmap(_header, _bytes);}
+
+    // Producer only.
+    void publish(const string &symbol, double price) {
+        uint64_t n = _header->head.load(memory_order_relaxed);
+        Slot &slot = _slots[n & (_header->capacity - 1)];
+        slot.sequence.store(Busy, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        uint64_t name = 0;
+        memcpy(&name, symbol.data(), min<size_t>(8, symbol.size()));
+        slot.symbol.store(name, memory_order_relaxed);
+        slot.price.store(bit_cast<uint64_t>(price), memory_order_relaxed);
+        slot.publishedNs.store(monotonicNs(), memory_order_relaxed);
+        slot.sequence.store(n + 1, memory_order_release);
+        _header->head.store(n + 1, memory_order_release);
+    }
+
+    enum ReadResult {Ok, NotYet, Overrun};
+
+    // Reads update number `sequence`. Overrun means the producer has
+    // already reused its slot; oldestAvailable() tells where to continue.
+    ReadResult read(uint64_t sequence, PriceUpdate &out) const {
+        const Slot &slot = _slots[sequence & (_header->capacity - 1)];
+        uint64_t before = slot.sequence.load(memory_order_acquire);
+        if (before != sequence + 1) {
+            if (before != Busy && before < sequence + 1) return NotYet;
+            return _header->head.load(memory_order_acquire) <= sequence ? NotYet : Overrun;
+        }
+        uint64_t name = slot.symbol.load(memory_order_relaxed);
+        uint64_t price = slot.price.load(memory_order_relaxed);
+        uint64_t published = slot.publishedNs.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != before) return Overrun;
+        out.sequence = sequence;
+        memcpy(out.symbol, &name, 8);
+        out.price = bit_cast<double>(price);
+        out.publishedNs = published;
+        return Ok;
+    }
+
+    uint64_t head() const {return _header->head.load(memory_order_acquire);}
+    uint64_t oldestAvailable() const {
+        uint64_t h = head();
+        return h > _header->capacity ? h - _header->capacity + 1 : 0;
+    }
+
+    // Lets the benchmark's producer wait for its consumers.
+    atomic<uint32_t> &readyConsumers() {return _header->readyConsumers;}
+
+private:
+    static constexpr uint64_t Magic = 0x474e495245434952; // "RICERING"
+    static constexpr uint64_t Busy = UINT64_MAX;
+
+    struct alignas(64) Header{
+        atomic<uint64_t> magic;
+        uint64_t capacity;
+        atomic<uint32_t> readyConsumers;
+        alignas(64) atomic<uint64_t> head; // next sequence number to write
+    };
+    struct alignas(32) Slot{
+        atomic<uint64_t> sequence; // n + 1 once update n is complete, Busy while writing
+        atomic<uint64_t> symbol;
+        atomic<uint64_t> price;    // bits of a double
+        atomic<uint64_t> publishedNs;
+    };
+
+    PriceRing(int fd, size_t bytes) : _bytes(bytes) {
+        void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) throw runtime_error("mmap of price ring failed");
+        _header = static_cast<Header *>(p);
+        _slots = reinterpret_cast<Slot *>(static_cast<char *>(p) + sizeof(Header));
+    }
+
+    Header *_header;
+    Slot *_slots;
+    size_t _bytes;
+};
+
+// Producer side: an Observer that forwards every Update into the ring.
+class RingPublisher : public Observer {
+public:
+    explicit RingPublisher(PriceRing &ring) : _ring(ring) {}
+    void Update(Stock *stock) override {_ring.publish(stock->getSymbol(), stock->getPrice());}
+private:
+    PriceRing &_ring;
+};
+
+// Consumer side: replays ring updates on local mirror stocks.
+class RingSubscriber{
+public:
+    explicit RingSubscriber(PriceRing &ring) : _ring(ring) {_next = ring.head();}
+
+    // The local stand-in for symbol; attach Investors to it.
+    IBM &mirror(const string &symbol) {
+        auto found = _mirrors.find(symbol);
+        if (found == _mirrors.end()) found = _mirrors.emplace(symbol, new IBM(symbol, 0)).first;
+        return *found->second;
+    }
+
+    // Delivers every update available now; returns how many. onUpdate, if
+    // given, sees each update before the mirror stock does.
+    template <typename F>
+    size_t poll(F onUpdate) {
+        size_t delivered = 0;
+        PriceUpdate update{};
+        while (true) {
+            PriceRing::ReadResult r = _ring.read(_next, update);
+            if (r == PriceRing::NotYet) return delivered;
+            if (r == PriceRing::Overrun) {
+                uint64_t resume = _ring.oldestAvailable();
+                _lost += resume > _next ? resume - _next : 1;
+                _next = max(resume, _next + 1);
+                continue;
+            }
+            _next++;
+            delivered++;
+            onUpdate(update);
+            string symbol(update.symbol, strnlen(update.symbol, 8));
+            auto found = _mirrors.find(symbol);
+            if (found != _mirrors.end()) found->second->setPrice(update.price);
+        }
+    }
+    size_t poll() {return poll([](const PriceUpdate &) {});}
+
+    uint64_t lost() const {return _lost;} // updates skipped because of overruns
+
+private:
+    PriceRing &_ring;
+    uint64_t _next;
+    uint64_t _lost = 0;
+    unordered_map<string, IBM *> _mirrors;
+};
+
+// Benchmark consumer: follows the ring until the producer's end marker.
+void consume(const string &name, uint64_t updates) {
+    PriceRing ring = PriceRing::open(name);
+    RingSubscriber subscriber(ring);
+    Investor investor("remote");
+    subscriber.mirror("IBM").Attach(&investor);
+    vector<uint64_t> latencies;
+    latencies.reserve(updates);
+    bool done = false;
+
+    ring.readyConsumers().fetch_add(1);
+    uint64_t start = monotonicNs();
+    size_t received = 0;
+    while (!done) {
+        size_t n = subscriber.poll([&](const PriceUpdate &u) {
+            latencies.push_back(monotonicNs() - u.publishedNs);
+            if (u.price < 0) done = true; // end marker
+        });
+        received += n;
+        if (n == 0) this_thread::yield();
+    }
+    double seconds = (double) (monotonicNs() - start) / 1e9;
+    sort(latencies.begin(), latencies.end());
+    auto at = [&](double p) {return latencies[min(latencies.size() - 1, (size_t) (p * (double) latencies.size()))];};
+    cout << "consumer " << getpid() << ": " << received << " updates, " << subscriber.lost() << " lost, "
+         << received / seconds << " updates/s, latency p50 " << at(0.5) << " ns, p99 " << at(0.99)
+         << " ns" << endl;
+}
+
+//test application
+int main(int argc, char *argv[]){
+    string name = "/ObserverSharedMemory-" + to_string(getpid());
+    try {
+        // Demo: an investor in another process follows IBM through the ring
+        {
+            PriceRing ring = PriceRing::create(name, 1024);
+            pid_t child = fork();
+            if (child == 0) {
+                PriceRing mine = PriceRing::open(name);
+                RingSubscriber subscriber(mine);
+                Investor ayhan("Ayhan");
+                subscriber.mirror("IBM").Attach(&ayhan);
+                mine.readyConsumers().fetch_add(1);
+                size_t seen = 0;
+                while (seen < 3) seen += subscriber.poll();
+                _exit(0);
+            }
+            while (ring.readyConsumers().load() < 1) this_thread::yield();
+            RingPublisher publisher(ring);
+            Investor ahmet("Ahmet");
+            IBM ibm("IBM", 120.00);
+            ibm.Attach(&ahmet);
+            ibm.Attach(&publisher);
+            ibm.setPrice(120.10);
+            ibm.setPrice(121.00);
+            ibm.setPrice(120.50);
+            waitpid(child, nullptr, 0);
+            PriceRing::remove(name);
+        }
+
+        // Benchmark: one producer, N consumer processes
+        uint64_t updates = argc > 1 ? stoull(argv[1]) : 1000000;
+        int consumers = argc > 2 ? stoi(argv[2]) : 2;
+        verbose = false;
+        cout << endl << updates << " updates to " << consumers << " consumer processes" << endl;
+        PriceRing ring = PriceRing::create(name, 1 << 16);
+        vector<pid_t> children;
+        for (int c = 0; c < consumers; c++) {
+            pid_t child = fork();
+            if (child == 0) {
+                consume(name, updates);
+                _exit(0);
+            }
+            children.push_back(child);
+        }
+        while (ring.readyConsumers().load() < (uint32_t) consumers) this_thread::yield();
+
+        RingPublisher publisher(ring);
+        IBM ibm("IBM", 120.00);
+        ibm.Attach(&publisher);
+        uint64_t start = monotonicNs();
+        for (uint64_t i = 0; i < updates; i++) {
+            ibm.setPrice(100 + (double) (i % 1000) * 0.01);
+            // yield now and then so consumers sharing our core can keep up
+            if ((i & 1023) == 1023) this_thread::yield();
+        }
+        double seconds = (double) (monotonicNs() - start) / 1e9;
+        ibm.setPrice(-1); // end marker
+        cout << "producer: " << updates / seconds << " updates/s" << endl;
+        for (pid_t child : children) waitpid(child, nullptr, 0);
+        PriceRing::remove(name);
+    }
+    catch (const exception &e) {
+        PriceRing::remove(name);
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : ObserverThreshold.cpp
+//============================================================================
+//Variant of ObserverPattern.cpp in which investors say which price changes
+//they care about, like the UpManager/DownManager split of
+//JavaLib/StockMediator.java but with a price level per investor:
+//	1. Subject  (Stock)
+//		. Attach(observer)              - every change, as before.
+//		. AttachAbove(observer, level)  - each time the price goes from at
+//		                                  or below level to above it.
+//		. AttachBelow(observer, level)  - each time the price goes from at
+//		                                  or above level to below it.
+//		. AttachMove(observer, percent) - when the price has moved by at
+//		                                  least percent since the last time
+//		                                  this observer was notified.
+//		. Thresholds are kept per stock in arrays sorted by level, so a
+//		  price change from p to q only looks at the levels between p and
+//		  q: the cost grows with the number of crossings, not subscribers.
+//		  A percent move is kept as its two trigger levels and re-armed
+//		  around the new price when it fires.
+//	2. ConcreteSubject  (IBM)
+//	3. Observer  (Investor)
+//	4. ConcreteObserver  (Investor)
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+    }
+    virtual ~Stock() = default;
+
+    //Register the Observers
+    void Attach (Observer *observer){
+        investors.push_back(observer);
+    }
+    void AttachAbove (Observer *observer, double level){
+        above.push_back({level, observer});
+        unsorted = true;
+    }
+    void AttachBelow (Observer *observer, double level){
+        below.push_back({level, observer});
+        unsorted = true;
+    }
+    void AttachMove (Observer *observer, double percent){
+        moves.push_back({observer, percent / 100.0, {}, {}});
+        arm((uint32_t) moves.size() - 1);
+    }
+
+    //Unregister from every list of observers
+    void Detach (Observer *observer){
+        auto other = [&](const Threshold &t) {return t.observer != observer;};
+        investors.erase(remove(investors.begin(), investors.end(), observer), investors.end());
+        above.erase(stable_partition(above.begin(), above.end(), other), above.end());
+        below.erase(stable_partition(below.begin(), below.end(), other), below.end());
+        for (uint32_t i = 0; i < moves.size(); i++) {
+            if (moves[i].observer != observer || moves[i].observer == nullptr) continue;
+            upTriggers.erase(moves[i].up);
+            downTriggers.erase(moves[i].down);
+            moves[i].observer = nullptr; // slot stays, ids of the others do not change
+        }
+    }
+
+    // Notifies the observers whose conditions hold for a change from
+    // oldPrice to the current price.
+    void Notify(double oldPrice) {
+        double newPrice = _price;
+        if (unsorted) sortThresholds();
+        for (auto & investor : investors){
+            investor->Update(this);
+        }
+        if (newPrice > oldPrice) {
+            // levels in [oldPrice, newPrice) were crossed upwards
+            auto first = lower_bound(above.begin(), above.end(), oldPrice, byLevel);
+            auto last = lower_bound(first, above.end(), newPrice, byLevel);
+            for (auto t = first; t != last; ++t) t->observer->Update(this);
+        }
+        else if (newPrice < oldPrice) {
+            // levels in (newPrice, oldPrice] were crossed downwards
+            auto first = upper_bound(below.begin(), below.end(), newPrice, levelBefore);
+            auto last = upper_bound(first, below.end(), oldPrice, levelBefore);
+            for (auto t = first; t != last; ++t) t->observer->Update(this);
+        }
+        if (moves.empty()) return;
+
+        // percent moves: up triggers at or below newPrice and down triggers
+        // at or above it have fired. Collect them first, because re-arming
+        // moves the triggers.
+        fired.clear();
+        auto upEnd = upTriggers.upper_bound(newPrice);
+        for (auto it = upTriggers.begin(); it != upEnd; ++it) fired.push_back(it->second);
+        for (auto it = downTriggers.lower_bound(newPrice); it != downTriggers.end(); ++it)
+            fired.push_back(it->second);
+        for (uint32_t id : fired) {
+            if (moves[id].up == upTriggers.end()) continue; // fired both ways at once
+            upTriggers.erase(moves[id].up);
+            downTriggers.erase(moves[id].down);
+            moves[id].up = upTriggers.end();
+        }
+        for (uint32_t id : fired) {
+            if (moves[id].up != upTriggers.end()) continue; // already re-armed
+            moves[id].observer->Update(this);
+            arm(id);
+        }
+    }
+
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    virtual void setPrice(double value) = 0;
+protected:
+    string _symbol;
+    double _price;
+    vector<Observer *> investors;
+
+private:
+    struct Threshold{
+        double level;
+        Observer *observer;
+    };
+    static bool byLevel(const Threshold &t, double level) {return t.level < level;}
+    static bool levelBefore(double level, const Threshold &t) {return level < t.level;}
+    // New thresholds are appended and sorted in one go before the next
+    // Notify, so attaching many of them stays cheap.
+    void sortThresholds() {
+        auto level = [](const Threshold &a, const Threshold &b) {return a.level < b.level;};
+        stable_sort(above.begin(), above.end(), level);
+        stable_sort(below.begin(), below.end(), level);
+        unsorted = false;
+    }
+
+    // Trigger level -> index into moves.
+    using Triggers = multimap<double, uint32_t>;
+    struct Move{
+        Observer *observer;
+        double fraction;
+        Triggers::iterator up, down;
+    };
+
+    // Places move id's triggers around the current price.
+    void arm(uint32_t id) {
+        Move &m = moves[id];
+        m.up = upTriggers.emplace(_price * (1 + m.fraction), id);
+        m.down = downTriggers.emplace(_price * (1 - m.fraction), id);
+    }
+
+    vector<Threshold> above; // sorted by level, unless unsorted is set
+    vector<Threshold> below; // sorted by level, unless unsorted is set
+    bool unsorted = false;
+    vector<Move> moves;
+    Triggers upTriggers;   // fire when the price rises to the level
+    Triggers downTriggers; // fire when the price falls to the level
+    vector<uint32_t> fired;
+};
+
+void Investor::Update(Stock *stock) {
+    _stock = stock;
+    _stock_price = _stock->getPrice();
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        double old = _price;
+        _price = value;
+        Notify(old);
+    }
+};
+
+// Counts notifications; stands in for a cheap real observer.
+class CountingObserver : public Observer {
+public:
+    void Update(Stock *) override {count++;}
+    uint64_t count = 0;
+};
+
+// Observer that gets every change and checks its own level, i.e. what the
+// investors have to do with the plain ObserverPattern.cpp subject.
+class FilteringObserver : public Observer {
+public:
+    FilteringObserver(double level, bool up) {_level = level; _up = up; _last = 120;}
+    void Update(Stock *stock) override {
+        double price = stock->getPrice();
+        if (_up ? (_last <= _level && price > _level) : (_last >= _level && price < _level)) count++;
+        _last = price;
+    }
+    uint64_t count = 0;
+private:
+    double _level, _last;
+    bool _up;
+};
+
+//test application
+int main(int argc, char *argv[]){
+    //Create Investors
+    auto *s = new Investor("Ahmet");
+    auto *b = new Investor("Ayhan");
+
+    // Ahmet wants to know when IBM breaks 121, Ayhan about 1% moves
+    IBM *ibm = new IBM("IBM", 120.00);
+    ibm->AttachAbove(s, 121);
+    ibm->AttachMove(b, 1);
+
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.50); // Ahmet and Ayhan
+    ibm->setPrice(120.50);
+    ibm->setPrice(122.75); // Ahmet and Ayhan
+    ibm->Detach(b);
+    ibm->setPrice(120);
+    ibm->setPrice(123);    // Ahmet
+
+    // Benchmark: random walk against N threshold subscriptions
+    size_t count = argc > 1 ? stoul(argv[1]) : 1000000;
+    int ticks = 1000;
+    verbose = false;
+    mt19937 gen(3);
+    uniform_real_distribution<double> level(108, 132);
+    normal_distribution<double> step(0, 0.05);
+
+    vector<double> walk(ticks);
+    double p = 120;
+    for (double &w : walk) w = p = clamp(p + step(gen), 100.0, 140.0);
+
+    vector<double> levels(count);
+    for (double &l : levels) l = level(gen);
+
+    // even subscriptions watch for upward, odd ones for downward crossings
+    IBM indexed("IBM", 120);
+    vector<CountingObserver> counters(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i % 2 == 0) indexed.AttachAbove(&counters[i], levels[i]);
+        else indexed.AttachBelow(&counters[i], levels[i]);
+    }
+    IBM plain("IBM", 120);
+    vector<FilteringObserver> filters;
+    filters.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        filters.emplace_back(levels[i], i % 2 == 0);
+        plain.Attach(&filters.back());
+    }
+
+    auto timed = [&](IBM &stock) {
+        auto start = chrono::steady_clock::now();
+        for (double w : walk) stock.setPrice(w);
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+    double plainSeconds = timed(plain);
+    double indexedSeconds = timed(indexed);
+    uint64_t plainHits = 0, indexedHits = 0;
+    for (auto &f : filters) plainHits += f.count;
+    for (auto &c : counters) indexedHits += c.count;
+
+    cout << endl << count << " threshold subscriptions, " << ticks << " ticks" << endl;
+    cout << "every investor filters : " << ticks / plainSeconds << " ticks/s, "
+         << plainHits << " crossings, " << (uint64_t) ticks * count << " Updates" << endl;
+    cout << "sorted threshold index : " << ticks / indexedSeconds << " ticks/s, "
+         << indexedHits << " crossings, " << indexedHits << " Updates" << endl;
+}
@@ -0,0 +1,195 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : SingletonContention.cpp
+//============================================================================
+//Measures what it costs N threads to reach a Singleton at the same time,
+//for five ways of writing GetLoadBalancer:
+//	1. mutex per call     - SingletonMultithreaded.cpp's NoDoubleCheck.
+//	2. double-checked     - the double-checked version, made correct: the
+//	                        instance pointer is atomic, published with a
+//	                        release store and read with an acquire load.
+//	3. call_once          - std::call_once with a once_flag.
+//	4. function-local     - a static local; the compiler inserts the
+//	   static               guard.
+//	5. constinit          - an instance built at compile time; access is
+//	                        a plain address.
+//Every thread calls its accessor in a loop. The report gives, per call:
+//	. wall time: from releasing the threads to the last join, divided by
+//	  all calls of all threads. It includes time spent blocked on the
+//	  mutex, which CPU time does not see.
+//	. CPU time, which means the same with or without enough cores.
+//	. cache misses, where the kernel allows perf events.
+
+// Stand-in for SingletonPattern.cpp's LoadBalancer. The constexpr
+// constructor lets the constinit strategy build it at compile time.
+class LoadBalancer{
+public:
+    constexpr LoadBalancer() = default;
+    const char *getServer(uint32_t i) const {return servers[i % 5];}
+private:
+    const char *servers[5] = {"Server I", "Server II", "Server III", "Server IV", "Server V"};
+};
+
+// 1. mutex per call
+mutex lockPerCall;
+LoadBalancer *lockedInstance = nullptr;
+[[gnu::noinline]] LoadBalancer *GetLoadBalancerMutex() {
+    lock_guard<mutex> guard(lockPerCall);
+    if (lockedInstance == nullptr) lockedInstance = new LoadBalancer();
+    return lockedInstance;
+}
+
+// 2. double-checked locking
+mutex dclpLock;
+atomic<LoadBalancer *> dclpInstance{nullptr};
+[[gnu::noinline]] LoadBalancer *GetLoadBalancerDoubleChecked() {
+    LoadBalancer *instance = dclpInstance.load(memory_order_acquire);
+    if (instance == nullptr) {
+        lock_guard<mutex> guard(dclpLock);
+        instance = dclpInstance.load(memory_order_relaxed);
+        if (instance == nullptr) {
+            instance = new LoadBalancer();
+            dclpInstance.store(instance, memory_order_release);
+        }
+    }
+    return instance;
+}
+
+// 3. call_once
+once_flag onceFlag;
+LoadBalancer *onceInstance = nullptr;
+[[gnu::noinline]] LoadBalancer *GetLoadBalancerCallOnce() {
+    call_once(onceFlag, [] {onceInstance = new LoadBalancer();});
+    return onceInstance;
+}
+
+// 4. function-local static
+[[gnu::noinline]] LoadBalancer *GetLoadBalancerLocalStatic() {
+    static LoadBalancer instance;
+    return &instance;
+}
+
+// 5. constinit
+constinit LoadBalancer eagerInstance;
+[[gnu::noinline]] LoadBalancer *GetLoadBalancerConstinit() {
+    return &eagerInstance;
+}
+
+// Counts the calling thread's cache misses, if perf events are allowed.
+class CacheMissCounter{
+public:
+    CacheMissCounter() {
+        perf_event_attr attr{};
+        attr.size = sizeof attr;
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    ~CacheMissCounter() {if (fd >= 0) close(fd);}
+    bool available() const {return fd >= 0;}
+    uint64_t read() const {
+        uint64_t value = 0;
+        if (fd < 0 || ::read(fd, &value, sizeof value) != (ssize_t) sizeof value) return 0;
+        return value;
+    }
+private:
+    int fd;
+};
+
+uint64_t threadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+struct Result{
+    double wallNsPerCall;
+    double cpuNsPerCall;
+    double missesPerCall; // negative when perf events are unavailable
+};
+
+Result hammer(LoadBalancer *(*get)(), int threads, uint64_t calls) {
+    atomic<int> ready{0};
+    atomic<bool> go{false};
+    atomic<uint64_t> cpuNs{0}, misses{0};
+    atomic<bool> counted{true};
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+        workers.emplace_back([&] {
+            CacheMissCounter counter;
+            if (!counter.available()) counted = false;
+            ready++;
+            while (!go.load()) this_thread::yield();
+            uint64_t startMisses = counter.read(), start = threadCpuNs();
+            uintptr_t sink = 0;
+            for (uint64_t i = 0; i < calls; i++) sink += (uintptr_t) get()->getServer((uint32_t) i);
+            cpuNs += threadCpuNs() - start + (sink == 1);
+            misses += counter.read() - startMisses;
+        });
+    while (ready.load() < threads) this_thread::yield();
+    auto start = chrono::steady_clock::now();
+    go = true;
+    for (thread &w : workers) w.join();
+    double wallNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    double total = (double) calls * threads;
+    return {wallNs / total, (double) cpuNs / total, counted ? (double) misses / total : -1};
+}
+
+int main(int argc, char *argv[]){
+    uint64_t calls = argc > 1 ? stoull(argv[1]) : 2000000;
+    int maxThreads = argc > 2 ? stoi(argv[2]) : 8;
+
+    struct Strategy{
+        const char *name;
+        LoadBalancer *(*get)();
+    } strategies[] = {
+        {"mutex per call", GetLoadBalancerMutex},
+        {"double-checked (atomic)", GetLoadBalancerDoubleChecked},
+        {"call_once", GetLoadBalancerCallOnce},
+        {"function-local static", GetLoadBalancerLocalStatic},
+        {"constinit", GetLoadBalancerConstinit},
+    };
+
+    // all of them hand out one instance
+    for (Strategy &s : strategies) {
+        LoadBalancer *first = s.get();
+        cout << s.name << ": " << (first == s.get() ? "Same Instance" : "Different Instance")
+             << " <" << first << ">" << endl;
+    }
+
+    cout << endl << calls << " calls per thread, "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+    for (Strategy &s : strategies) {
+        cout << s.name << ":" << endl;
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            Result r = hammer(s.get, threads, calls);
+            cout << "  " << threads << " threads: " << r.wallNsPerCall << " ns/call wall, "
+                 << r.cpuNsPerCall << " ns/call CPU";
+            if (r.missesPerCall >= 0) cout << ", " << r.missesPerCall << " cache misses/call";
+            else cout << ", cache misses n/a (perf events not permitted)";
+            cout << endl;
+        }
+    }
+}
@@ -1,8 +1,12 @@
 #include <iostream>
-#include <sstream>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <mutex> // contains lock
 #include <random>
+#include <string>
 #include <thread>
 
 using namespace std;
@@ -12,33 +16,287 @@ using namespace std;
 //		Defines an Instance operation that lets clients access its unique
 //		instance. Instance is a class operation. Responsible for
 //		creating and maintaining its own unique instance
+//2. ThreadRegistry
+//		Gives every thread a small dense id and a name once, and caches
+//		them thread-locally. When a thread exits, its counters are added
+//		to a total for finished threads and its entry, id included, is
+//		reused by the next new thread.
+//3. InstrumentedMutex
+//		A mutex that counts acquisitions, contended acquisitions and time
+//		spent waiting, per lock and per (lock, thread) pair. An uncontended
+//		lock costs a try_lock and a few plain stores; snapshots and
+//		dumpLockStats read the counters from any thread.
 
 // function prototypes
-string threadIDtoName(const string& id);
-void MyRunnable(char type);
+void MyRunnable(char type, int number);
+
+// Dense thread ids and names, assigned on a thread's first use.
+class ThreadRegistry {
+public:
+    struct LockCounters {
+        atomic<uint64_t> acquisitions{0}, contended{0}, waitNs{0};
+    };
+    struct Info {
+        uint32_t id = 0;
+        string name;
+        bool live = false; // false while on the free list
+        // this thread's statistics for each lock, indexed by lock id and
+        // written only by the thread itself; grow guards adding entries
+        // against readers
+        mutex grow;
+        deque<LockCounters> locks;
+    };
+    struct LockUse {
+        uint32_t lock;
+        uint64_t acquisitions, contended, waitNs;
+    };
+    struct Snapshot {
+        uint32_t id;
+        string name;
+        uint64_t acquisitions = 0, contended = 0, waitNs = 0; // over all locks
+        vector<LockUse> locks;                               // the locks it used
+    };
+
+    static Info &current() {
+        thread_local InfoOwner mine;
+        if (mine.info == nullptr) mine.info = &enroll();
+        return *mine.info;
+    }
+    static uint32_t id() {return current().id;}
+    static const string &name() {return current().name;}
+    static void setName(string name) {
+        Info &mine = current();
+        lock_guard<mutex> guard(lock);
+        mine.name = move(name);
+    }
+
+    // The calling thread's counters for one lock.
+    static LockCounters &countersFor(uint32_t lockId) {
+        Info &mine = current();
+        if (lockId >= mine.locks.size()) { // only this thread adds entries
+            lock_guard<mutex> guard(mine.grow);
+            while (mine.locks.size() <= lockId) mine.locks.emplace_back();
+        }
+        return mine.locks[lockId];
+    }
+
+    // Every running thread that has used the registry.
+    static vector<Snapshot> snapshot() {
+        lock_guard<mutex> guard(lock);
+        vector<Snapshot> result;
+        for (Info &t : threads) {
+            if (!t.live) continue;
+            Snapshot &s = result.emplace_back();
+            s.id = t.id;
+            s.name = t.name;
+            lock_guard<mutex> growing(t.grow);
+            for (uint32_t l = 0; l < t.locks.size(); l++) {
+                LockUse use{l, t.locks[l].acquisitions.load(memory_order_relaxed),
+                            t.locks[l].contended.load(memory_order_relaxed),
+                            t.locks[l].waitNs.load(memory_order_relaxed)};
+                if (use.acquisitions == 0) continue;
+                s.acquisitions += use.acquisitions;
+                s.contended += use.contended;
+                s.waitNs += use.waitNs;
+                s.locks.push_back(use);
+            }
+        }
+        return result;
+    }
+
+    // The sum over all threads that have exited; id is how many did.
+    static Snapshot retired() {
+        lock_guard<mutex> guard(lock);
+        Snapshot s;
+        s.id = retiredThreads;
+        s.name = "finished threads";
+        for (uint32_t l = 0; l < retiredLocks.size(); l++) {
+            const LockUse &use = retiredLocks[l];
+            if (use.acquisitions == 0) continue;
+            s.acquisitions += use.acquisitions;
+            s.contended += use.contended;
+            s.waitNs += use.waitNs;
+            s.locks.push_back(use);
+        }
+        return s;
+    }
+
+private:
+    // Hands the thread's Info back when the thread exits.
+    struct InfoOwner {
+        Info *info = nullptr;
+        ~InfoOwner() {if (info != nullptr) retire(*info);}
+    };
+
+    static Info &enroll() {
+        lock_guard<mutex> guard(lock);
+        Info *mine;
+        if (!freeInfos.empty()) {
+            mine = freeInfos.back();
+            freeInfos.pop_back();
+        }
+        else {
+            mine = &threads.emplace_back(); // a deque never moves its elements
+            mine->id = (uint32_t) threads.size() - 1;
+        }
+        mine->name = "Thread " + to_string(mine->id);
+        mine->live = true;
+        return *mine;
+    }
+
+    // Runs on the exiting thread, the only writer of its counters.
+    static void retire(Info &info) {
+        lock_guard<mutex> guard(lock);
+        lock_guard<mutex> growing(info.grow);
+        if (retiredLocks.size() < info.locks.size()) retiredLocks.resize(info.locks.size());
+        for (uint32_t l = 0; l < info.locks.size(); l++) {
+            LockCounters &c = info.locks[l];
+            LockUse &total = retiredLocks[l];
+            total.lock = l;
+            total.acquisitions += c.acquisitions.exchange(0, memory_order_relaxed);
+            total.contended += c.contended.exchange(0, memory_order_relaxed);
+            total.waitNs += c.waitNs.exchange(0, memory_order_relaxed);
+        }
+        info.live = false;
+        retiredThreads++;
+        freeInfos.push_back(&info);
+    }
+
+    static mutex lock; // guards everything below, and every Info's name and live
+    static deque<Info> threads;
+    static vector<Info *> freeInfos;
+    static vector<LockUse> retiredLocks; // by lock id
+    static uint32_t retiredThreads;
+};
+
+class InstrumentedMutex {
+public:
+    struct Snapshot {
+        string name;
+        uint64_t acquisitions, contended, waitNs;
+    };
+
+    explicit InstrumentedMutex(string name) : _name(move(name)) {
+        lock_guard<mutex> guard(registryLock);
+        _id = (uint32_t) names.size();
+        names.push_back(_name);
+        registry.push_back(this);
+    }
+    ~InstrumentedMutex() {
+        lock_guard<mutex> guard(registryLock);
+        registry.erase(remove(registry.begin(), registry.end(), this), registry.end());
+    }
+
+    void lock() {
+        ThreadRegistry::LockCounters &me = ThreadRegistry::countersFor(_id);
+        if (_mutex.try_lock()) {
+            add(acquisitions, 1);
+            add(me.acquisitions, 1);
+            return;
+        }
+        auto start = chrono::steady_clock::now();
+        _mutex.lock();
+        auto waited = (uint64_t) chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        add(acquisitions, 1);
+        add(contended, 1);
+        add(waitNs, waited);
+        add(me.acquisitions, 1);
+        add(me.contended, 1);
+        add(me.waitNs, waited);
+    }
+    bool try_lock() {
+        if (!_mutex.try_lock()) return false;
+        add(acquisitions, 1);
+        add(ThreadRegistry::countersFor(_id).acquisitions, 1);
+        return true;
+    }
+    void unlock() {_mutex.unlock();}
+
+    static vector<Snapshot> snapshot() {
+        lock_guard<mutex> guard(registryLock);
+        vector<Snapshot> result;
+        for (InstrumentedMutex *m : registry)
+            result.push_back({m->_name, m->acquisitions.load(memory_order_relaxed),
+                              m->contended.load(memory_order_relaxed), m->waitNs.load(memory_order_relaxed)});
+        return result;
+    }
+
+    // Name of the lock with this id; ids are never reused, so this also
+    // works for locks that no longer exist.
+    static string name(uint32_t id) {
+        lock_guard<mutex> guard(registryLock);
+        return id < names.size() ? names[id] : "?";
+    }
+
+private:
+    // The counters have one writer at a time (the lock holder, or the
+    // owning thread), so a plain store is enough; readers may see them a
+    // little late.
+    static void add(atomic<uint64_t> &counter, uint64_t value) {
+        counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+    }
+
+    mutex _mutex;
+    string _name;
+    uint32_t _id;
+    atomic<uint64_t> acquisitions{0}, contended{0}, waitNs{0};
+
+    static mutex registryLock;
+    static vector<InstrumentedMutex *> registry;
+    static vector<string> names; // by lock id
+
+};
+
+// Prints the statistics of every lock, every thread, and each thread's
+// share of every lock it used.
+void dumpLockStats(ostream &out) {
+    auto counts = [&out](uint64_t acquisitions, uint64_t contended, uint64_t waitNs) {
+        out << acquisitions << " acquisitions, " << contended << " contended, "
+            << (double) waitNs / 1e6 << " ms waiting" << endl;
+    };
+    out << "locks:" << endl;
+    for (auto &l : InstrumentedMutex::snapshot()) {
+        out << "  " << l.name << ": ";
+        counts(l.acquisitions, l.contended, l.waitNs);
+    }
+    auto thread = [&](const ThreadRegistry::Snapshot &t) {
+        counts(t.acquisitions, t.contended, t.waitNs);
+        for (auto &use : t.locks) {
+            out << "    " << InstrumentedMutex::name(use.lock) << ": ";
+            counts(use.acquisitions, use.contended, use.waitNs);
+        }
+    };
+    out << "threads:" << endl;
+    for (auto &t : ThreadRegistry::snapshot()) {
+        out << "  #" << t.id << " " << t.name << ": ";
+        thread(t);
+    }
+    ThreadRegistry::Snapshot retired = ThreadRegistry::retired();
+    out << "  " << retired.id << " " << retired.name << ": ";
+    thread(retired);
+}
 
 // singleton load balancer class
 class LoadBalancer {
 private:
     vector<string> servers;
-    static mutex lock;
-    static LoadBalancer *instance;
+    static InstrumentedMutex lock;
+    static atomic<LoadBalancer *> instance; // read outside the lock, so atomic
 public:
     // Thread Safe Load Balancer with Double-Checked Locking
     LoadBalancer *GetLoadBalancer(){
         // prints thread name
-        auto threadID = this_thread::get_id();
-        stringstream ss;
-        ss << threadID;
-        string tName = threadIDtoName(ss.str());
+        const string &tName = ThreadRegistry::name();
 
-        //check 1
-        if (instance == nullptr){
+        //check 1: acquire pairs with the release store below, so a thread
+        //that sees the pointer also sees the constructed LoadBalancer
+        LoadBalancer *current = instance.load(memory_order_acquire);
+        if (current == nullptr){
             lock.lock();
             cout << tName << " acquired lock" << endl;
             try{ //check 2
-                if (instance == nullptr){
-                    instance = new LoadBalancer();
+                if (instance.load(memory_order_relaxed) == nullptr){
+                    instance.store(new LoadBalancer(), memory_order_release);
                 }
             }
             catch (...){ //for all errors, unlock and return nullptr
@@ -48,25 +306,22 @@ public:
             }
             lock.unlock(); // if there is no error, unlock anyway and return instance
             cout << tName << " released lock" << endl;
-            return instance;
+            return instance.load(memory_order_relaxed);
         }
-        return instance; // no costly locking required if instance isn't null
+        return current; // no costly locking required if instance isn't null
     }
 
     LoadBalancer* GetLoadBalancerNoDoubleCheck(){
 
         // prints thread name
-        auto threadID = this_thread::get_id();
-        stringstream ss;
-        ss << threadID;
-        string tName = threadIDtoName(ss.str());
+        const string &tName = ThreadRegistry::name();
 
         // lock occurs regardless of whether instance exists
         lock.lock();
         cout << tName << " acquired lock" << endl;
         try{
-            if (instance == nullptr){
-                    instance = new LoadBalancer();
+            if (instance.load(memory_order_relaxed) == nullptr){
+                    instance.store(new LoadBalancer(), memory_order_release);
             }
         }
         catch (...){
@@ -76,13 +331,13 @@ public:
             }
         lock.unlock();
         cout << tName << " released lock" << endl;
-        return instance;
+        return instance.load(memory_order_relaxed);
     }
 
     //simple LoadBalancer - returns a random server at an index between 0 and 4
     string getServer() {
-        random_device randomDevice;
-        mt19937 gen(randomDevice());
+        // one generator per thread, seeded once; see LoadBalancerPolicies.cpp
+        thread_local mt19937 gen(random_device{}());
         uniform_int_distribution<> distribution(0, (int) servers.size() - 1);
         int rand = distribution(gen);
         return servers.at(rand);
@@ -99,22 +354,12 @@ public:
     static void initInstance() {instance = nullptr;}
 };
 
-// Maps the thread's identification number to a convenient name.
-string threadIDtoName(const string& id) {
-    if (id == "2" || id == "5") {return "Thread 1: ";}
-    if (id == "3" || id == "6") {return "Thread 2: ";}
-    if (id == "4" || id == "7") {return "Thread 3: ";}
-    return "Unmapped Thread";
-}
-
 //Runnable Routine
-void MyRunnable(char type){
-    auto threadID = this_thread::get_id();
-    stringstream ss;
-    ss << threadID;
-    string tName = threadIDtoName(ss.str());
+void MyRunnable(char type, int number){
+    ThreadRegistry::setName("Thread " + to_string(number));
+    const string &tName = ThreadRegistry::name();
 
-    LoadBalancer *lb;
+    LoadBalancer *lb = nullptr;
     if (type == 'D')
         lb = (new LoadBalancer)->GetLoadBalancer();
     if (type == 'N')
@@ -126,36 +371,87 @@ void MyRunnable(char type){
 
 
 
-// type declarations for static vars
-LoadBalancer *LoadBalancer::instance;
-mutex LoadBalancer::lock;
+// type declarations for static vars; the registries come first, since
+// constructing LoadBalancer::lock registers it
+mutex ThreadRegistry::lock;
+deque<ThreadRegistry::Info> ThreadRegistry::threads;
+vector<ThreadRegistry::Info *> ThreadRegistry::freeInfos;
+vector<ThreadRegistry::LockUse> ThreadRegistry::retiredLocks;
+uint32_t ThreadRegistry::retiredThreads = 0;
+mutex InstrumentedMutex::registryLock;
+vector<InstrumentedMutex *> InstrumentedMutex::registry;
+vector<string> InstrumentedMutex::names;
+atomic<LoadBalancer *> LoadBalancer::instance;
+InstrumentedMutex LoadBalancer::lock("LoadBalancer::lock");
 
 int main(){
+    ThreadRegistry::setName("Main");
 
     cout << "START NO DOUBLE CHECKED LOCKING" << endl;
     // We have to create a scenario in which threads are starting
     // sequentially in order show the tradeoffs of double-checking
 
     LoadBalancer::initInstance();
-    thread t1(MyRunnable, 'N');
+    thread t1(MyRunnable, 'N', 1);
     t1.join();
 
-    thread t2(MyRunnable, 'N');
+    thread t2(MyRunnable, 'N', 2);
     t2.join();
 
-    thread t3(MyRunnable, 'N');
+    thread t3(MyRunnable, 'N', 3);
     t3.join();
 
     LoadBalancer::initInstance(); // resets instance
     // We have to create a scenario in which threads are starting sequentially
     // in order show the real advantage of double-checking
     cout << endl << "START DOUBLE CHECKED LOCKING" << endl;
-    thread thr1(MyRunnable, 'D');
+    thread thr1(MyRunnable, 'D', 1);
     thr1.join();
 
-    thread thr2(MyRunnable, 'D');
+    thread thr2(MyRunnable, 'D', 2);
     thr2.join();
 
-    thread thr3(MyRunnable, 'D');
+    thread thr3(MyRunnable, 'D', 3);
     thr3.join();
+
+    // Four workers sharing one lock, to have some contention to look at.
+    // They stay alive until the stats are dumped, so each shows up on its
+    // own; the threads above have exited and are summed in one line.
+    cout << endl << "START CONTENDED WORKERS" << endl;
+    InstrumentedMutex requestLock("request lock");
+    LoadBalancer *lb = (new LoadBalancer)->GetLoadBalancer();
+    vector<thread> workers;
+    atomic<int> finished{0};
+    atomic<bool> dumped{false};
+    for (int w = 1; w <= 4; w++)
+        workers.emplace_back([&, w] {
+            ThreadRegistry::setName("Worker " + to_string(w));
+            size_t sink = 0;
+            for (int i = 0; i < 20000; i++) {
+                lock_guard<InstrumentedMutex> guard(requestLock);
+                sink += lb->getServer().size();
+            }
+            if (sink == 0) cout << "no servers" << endl;
+            finished++;
+            while (!dumped) this_thread::yield();
+        });
+    while (finished < 4) this_thread::yield();
+    cout << endl;
+    dumpLockStats(cout);
+    dumped = true;
+    for (thread &w : workers) w.join();
+
+    // cost of the uncontended path
+    mutex plain;
+    InstrumentedMutex instrumented("uncontended benchmark");
+    auto perLock = [](auto &m) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < 10000000; i++) {
+            m.lock();
+            m.unlock();
+        }
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / 1e7;
+    };
+    cout << endl << "uncontended lock+unlock: mutex " << perLock(plain) << " ns, InstrumentedMutex "
+         << perLock(instrumented) << " ns" << endl;
 }
@@ -30,6 +30,7 @@ public:
                 lock.unlock();
                 return nullptr;
             }
+            lock.unlock();
             cout << "Released Lock\n";
             return instance;
 
@@ -38,8 +39,8 @@ public:
     }
 
     string getServer(){
-        random_device randomDevice;
-        mt19937 gen(randomDevice());
+        // one generator per thread, seeded once; see LoadBalancerPolicies.cpp
+        thread_local mt19937 gen(random_device{}());
         uniform_int_distribution<> distribution(0, (int) servers.size() - 1);
 
         int rand = distribution(gen);
@@ -0,0 +1,319 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : StockMediator.cpp
+//============================================================================
+//C++ version of JavaLib/StockMediator.java, built on the Stock/Investor
+//classes of ObserverPattern.cpp:
+//	1. Stock (Subject)
+//		. Knows its managers and implements Attach, Detach, and Notify
+//		  through them. Managers are shared by all stocks.
+//		. Keeps _last_price, the price at its last notification.
+//		. NotifyAll(stocks) notifies many stocks in one pass.
+//	   a. IBM : Concrete Stock that lets client set price for testing purposes.
+//	2. Mediator
+//		. Routes a price change to the observers subscribed to that stock
+//		  for that direction. The table is indexed by a dense stock id, so
+//		  a notification only visits its own stock's subscribers.
+//	   a. UpManager   : notifies if the price went up.
+//	   b. DownManager : notifies if the price went down.
+//	3. Observer (Abstract Observer)
+//	   a. Investor (Concrete Observer)
+
+//forward declarations
+class Observer;
+class Investor;
+class Stock;
+
+// When false, investors are updated silently. The benchmark turns it off.
+static bool verbose = true;
+
+//'Observer'  ==> Abstract Observer.
+class Observer{
+public:
+    virtual ~Observer() = default;
+    virtual void Update(Stock *stock){};
+};
+
+
+//'ConcreteObserver' ==> Investor
+class Investor : public Observer {
+private:
+    Stock *_stock{};
+    string _investor_name;
+    string _stock_name;   // Internal Observer state
+    double _stock_price{};   // Internal Observer state
+
+public:
+    // Constructor
+    explicit Investor(string name) {
+        _investor_name = move(name);
+    }
+    void Update(Stock *stock) override;
+
+    Stock* getStock() {return _stock;}
+    void setStock(Stock *value) {_stock = value;}
+    string getName() {return _investor_name;}
+};
+
+
+// The Mediator: subscribers per stock id for one direction.
+class Mediator{
+public:
+    virtual ~Mediator() = default;
+
+    void attach(Observer *observer, uint32_t stock) {
+        if (stock >= table.size()) table.resize(stock + 1);
+        table[stock].push_back(observer);
+    }
+    void detach(Observer *observer) {
+        for (auto &row : table) detach(observer, row);
+    }
+    void detach(Observer *observer, uint32_t stock) {
+        if (stock < table.size()) detach(observer, table[stock]);
+    }
+
+    virtual void Notify(Stock *stock) = 0;
+
+    // Updates the subscribers of one stock, whatever the direction.
+    void Route(Stock *stock, uint32_t id) {
+        if (id >= table.size()) return;
+        for (Observer *observer : table[id]) observer->Update(stock);
+    }
+
+protected:
+    static void detach(Observer *observer, vector<Observer *> &row) {
+        erase(row, observer);
+    }
+    vector<vector<Observer *>> table; // stock id -> subscribers
+};
+
+
+//'Subject' ==> Stock
+class Stock{
+public:
+    Stock(string symbol, double price){
+        _symbol = move(symbol);
+        _price = price;
+        _last_price = price;
+        _id = nextId++;
+    }
+    virtual ~Stock() = default;
+
+    //Register the Observers
+    void Attach (Observer *observer, char mode){
+        if (mode == 'U' || mode == 'u'){
+            managers[0]->attach(observer, _id);
+        }
+        else if (mode == 'D' || mode == 'd') {
+            managers[1]->attach(observer, _id);
+        }
+        else {cout << "Invalid Mode: 'U' or 'D' only." << endl;}
+    }
+    //Unregister (a) from all managers or (b) from a specific mode.
+    void Detach (Observer *observer){
+        for (Mediator *manager : managers){
+            manager->detach(observer, _id);
+        }
+    }
+    void Detach (Observer *observer, char mode){
+        if (mode == 'U' || mode == 'u'){
+            managers[0]->detach(observer, _id);
+        }
+        else if (mode == 'D' || mode == 'd') {
+            managers[1]->detach(observer, _id);
+        }
+    }
+
+    //Notify the Observers.
+    void Notify() {
+        for (Mediator *manager : managers) {
+            manager->Notify(this);
+        }
+        _last_price = _price;
+    }
+
+    // Notifies every stock whose price moved since its last notification,
+    // in one pass: the direction is checked once per stock and the change
+    // goes straight to that direction's table. Stocks quoted several times
+    // since then notify once, with the net move.
+    static void NotifyAll(span<Stock *const> stocks) {
+        for (Stock *stock : stocks) {
+            if (stock->_price > stock->_last_price) managers[0]->Route(stock, stock->_id);
+            else if (stock->_price < stock->_last_price) managers[1]->Route(stock, stock->_id);
+            stock->_last_price = stock->_price;
+        }
+    }
+
+    string getSymbol() {return _symbol;}
+    void setSymbol(string value) {_symbol = move(value);}
+    double getPrice() {return _price;}
+    double getLastPrice() {return _last_price;}
+    uint32_t getId() {return _id;}
+    virtual void setPrice(double value) = 0;
+    // Changes the price without notifying; see NotifyAll.
+    void Quote(double value) {_price = value;}
+protected:
+    string _symbol;
+    double _price;
+    double _last_price;
+    uint32_t _id;
+    static uint32_t nextId;
+    static Mediator *managers[2]; // all stocks share the same two managers
+};
+
+class UpManager : public Mediator{
+public:
+    void Notify(Stock *stock) override {
+        if (stock->getPrice() > stock->getLastPrice()) Route(stock, stock->getId());
+    }
+};
+
+class DownManager : public Mediator{
+public:
+    void Notify(Stock *stock) override {
+        if (stock->getPrice() < stock->getLastPrice()) Route(stock, stock->getId());
+    }
+};
+
+// type declarations for static vars
+uint32_t Stock::nextId = 0;
+Mediator *Stock::managers[2] = {new UpManager(), new DownManager()};
+
+void Investor::Update(Stock *stock) {
+    _stock = stock;
+    _stock_price = _stock->getPrice();
+    if (!verbose) return;
+    _stock_name = _stock->getSymbol();
+    cout << "Notified " << _investor_name << " of " << _stock_name << "'s "
+         << "change to " << _stock_price << endl;
+
+}
+//'ConcreteSubject' ==> IBM
+class IBM: public Stock {
+    //Constructor
+public:
+    IBM (string symbol, double price) : Stock(move(symbol), price){}
+    double getPrice() {return _price;}
+    void setPrice (double value) override {
+        // Whenever a change happens to _price, notify
+        // observers.
+        _price = value;
+        Notify();
+    }
+};
+
+// Counts notifications; stands in for a cheap real observer.
+class CountingObserver : public Observer {
+public:
+    void Update(Stock *) override {count++;}
+    uint64_t count = 0;
+};
+
+template <typename F>
+double seconds(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//test application
+int main(int argc, char *argv[]){
+    // Create investors
+    auto *s = new Investor("Ahmet");
+    auto *b = new Investor("Berna");
+
+    // Create IBM stock and attach investors
+    IBM *ibm = new IBM("IBM", 120.00);
+    s->setStock(ibm);
+    b->setStock(ibm);
+    ibm->Attach(s, 'U');
+    ibm->Attach(b, 'D');
+
+    // Change price, which notifies investors
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.00);
+    ibm->setPrice(120.50);
+    ibm->setPrice(120.75);
+
+    cout << "\nMoving Berna from Down to Up Notification list" << endl;
+    ibm->Detach(b, 'D');
+    ibm->Attach(b, 'U');
+
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.00);
+    ibm->setPrice(120.50);
+    ibm->setPrice(120.75);
+
+    cout << "\nRemoving Ahmet from all notification lists" << endl;
+    ibm->Detach(s);
+
+    ibm->setPrice(120.10);
+    ibm->setPrice(121.00);
+    ibm->setPrice(120.50);
+    ibm->setPrice(120.75);
+
+    // Benchmark: N stocks with 8 up and 8 down subscribers each. Ticks hit
+    // random stocks, the low-numbered ones more often; NotifyAll runs once
+    // per N ticks.
+    size_t count = argc > 1 ? stoul(argv[1]) : 10000;
+    int rounds = 200;
+    size_t perDirection = 8;
+    verbose = false;
+
+    vector<IBM> stocks;
+    stocks.reserve(count);
+    for (size_t i = 0; i < count; i++) stocks.emplace_back("S" + to_string(i), 100);
+    vector<CountingObserver> counters(count * perDirection * 2);
+    for (size_t i = 0; i < count; i++)
+        for (size_t k = 0; k < perDirection; k++) {
+            stocks[i].Attach(&counters[(i * perDirection + k) * 2], 'U');
+            stocks[i].Attach(&counters[(i * perDirection + k) * 2 + 1], 'D');
+        }
+    vector<Stock *> pointers;
+    for (IBM &stock : stocks) pointers.push_back(&stock);
+
+    // the same ticks for both runs
+    struct Tick{uint32_t stock; double move;};
+    mt19937 gen(5);
+    uniform_real_distribution<double> u(0, 1);
+    normal_distribution<double> step(0, 0.1);
+    vector<Tick> ticks(count * rounds);
+    for (Tick &t : ticks) t = {(uint32_t) ((double) count * u(gen) * u(gen)), step(gen)};
+
+    auto updates = [&] {
+        uint64_t total = 0;
+        for (auto &c : counters) total += c.count;
+        return total;
+    };
+    double perStockSeconds = seconds([&] {
+        for (Tick &t : ticks) stocks[t.stock].setPrice(stocks[t.stock].getPrice() + t.move);
+    });
+    uint64_t perStockUpdates = updates();
+    for (IBM &stock : stocks) stock.setPrice(100); // back to the start of the path
+    for (auto &c : counters) c.count = 0;
+
+    double batchedSeconds = seconds([&] {
+        for (size_t first = 0; first < ticks.size(); first += count) {
+            for (size_t i = first; i < first + count; i++)
+                stocks[ticks[i].stock].Quote(stocks[ticks[i].stock].getPrice() + ticks[i].move);
+            Stock::NotifyAll(pointers);
+        }
+    });
+    uint64_t batchedUpdates = updates();
+
+    double n = (double) ticks.size();
+    cout << endl << count << " stocks, " << perDirection << " up and " << perDirection
+         << " down subscribers each, " << ticks.size() << " ticks" << endl;
+    cout << "per-stock Notify : " << perStockSeconds / n * 1e9 << " ns/tick, "
+         << perStockUpdates << " Updates" << endl;
+    cout << "batched NotifyAll: " << batchedSeconds / n * 1e9 << " ns/tick, "
+         << batchedUpdates << " Updates (net move per stock per batch)" << endl;
+}
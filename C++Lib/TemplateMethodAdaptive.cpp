@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+//============================================================================
+//Name        : TemplateMethodAdaptive.cpp
+//
+//TemplateMethod.cpp with a check() that learns the best order of its steps:
+//1. AbstractClass  (CheckBackground)
+//			check() runs the five primitive operations as a short-circuit
+//			chain, as before. In adaptive mode it also samples how long
+//			each step takes and how often it rejects, and every
+//			ReorderEvery applications it sorts the steps by
+//			cost / rejection rate, the order that minimises the expected
+//			cost of a chain of independent checks. Pinned steps keep their
+//			position; the others are reordered around them.
+//2. ConcreteClass  (MortgageLoanApp, EquityLoanApp)
+//			The primitive operations now look at a real applicant (Data)
+//			and take time like the lookups they stand for.
+//============================================================================
+
+// When false, the checks print nothing. The benchmark turns it off.
+static bool verbose = true;
+
+class Data {
+public:
+    int income = 50000;
+    int creditScore = 650;
+    int bankBalance = 10000;
+    int openLoans = 0;
+    int stockValue = 0;
+};
+
+// Stands in for the work of a lookup: about `rounds` dependent steps.
+bool lookup(int rounds, uint64_t seed) {
+    for (int i = 0; i < rounds; i++) seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed != 0;
+}
+
+//This is the AbstractClass class.
+
+class CheckBackground {
+public:
+    enum Step {Bank, Credit, Loan, Stock, Income, StepCount};
+    static constexpr uint32_t ReorderEvery = 4096;
+    static constexpr uint32_t SampleEvery = 16; // time one application in 16
+
+    explicit CheckBackground(string name){_name = move(name);}
+    virtual ~CheckBackground() = default;
+    string getName() {return _name;}
+    void setData(const Data &data) {_data = data;}
+
+    void setAdaptive(bool value) {adaptive = value;}
+    // Keeps step at its current position in the order.
+    void pin(Step step) {pinned[step] = true;}
+    const array<Step, StepCount> &getOrder() const {return order;}
+    static const char *stepName(Step step) {
+        static const char *names[] = {"bank", "credit", "loan", "stock", "income"};
+        return names[step];
+    }
+
+    //This is our template method.
+    bool check() {
+        prepareApplication();
+        bool status;
+        if (!adaptive) {
+            status = checkBank() && checkCredit() && checkLoan()
+                     && checkStock() && checkIncome();
+        }
+        else if (++applications % SampleEvery != 0) {
+            status = true;
+            for (Step step : order) {
+                stats[step].calls++;
+                if (!run(step)) {
+                    stats[step].rejections++;
+                    status = false;
+                    break;
+                }
+            }
+        }
+        else {
+            status = runTimed();
+        }
+        if (adaptive && applications % ReorderEvery == 0) reorder();
+        finalizeApplication(status);
+        return status;
+    }
+
+    // These are our concrete template operations.
+protected:
+    static void prepareApplication() {
+        if (verbose) cout << "Prepared Paperwork" << endl;
+    }
+    static void finalizeApplication(bool status) {
+        if (!verbose) return;
+        if (status){cout << "Application Accepted\n";}
+        else {cout << "Application Rejected\n";}
+    }
+    // These are Primitive Operations which will be overridden
+    // by the subclasses. They are all abstract.
+    string _name;
+    Data _data;
+    virtual bool checkBank() = 0;
+    virtual bool checkCredit() = 0;
+    virtual bool checkLoan() = 0;
+    virtual bool checkIncome() = 0;
+    virtual bool checkStock() = 0;
+
+private:
+    // Doubles, not integers: reorder() halves them, and halving a small
+    // count must not round it away.
+    struct StepStats{
+        double calls = 0, rejections = 0;
+        double timedCalls = 0;
+        double timedNs = 0;
+    };
+
+    bool run(Step step) {
+        switch (step) {
+            case Bank: return checkBank();
+            case Credit: return checkCredit();
+            case Loan: return checkLoan();
+            case Stock: return checkStock();
+            case Income: return checkIncome();
+            default: return true;
+        }
+    }
+
+    bool runTimed() {
+        for (Step step : order) {
+            auto start = chrono::steady_clock::now();
+            bool ok = run(step);
+            stats[step].timedNs += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+            stats[step].timedCalls++;
+            stats[step].calls++;
+            if (!ok) {
+                stats[step].rejections++;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Sorts the unpinned steps by expected cost per rejection. Old
+    // observations count half each time, so the order follows drift.
+    void reorder() {
+        auto rank = [&](Step s) {
+            const StepStats &st = stats[s];
+            // a step that was never timed is assumed expensive (1 s) until it is
+            double cost = st.timedCalls > 0 ? st.timedNs / st.timedCalls : 1e9;
+            // a step that was never reached or never rejects goes last
+            double rejectRate = st.calls > 0 ? st.rejections / st.calls : 0;
+            return cost / max(rejectRate, 1e-6);
+        };
+        vector<Step> movable;
+        for (Step s : order)
+            if (!pinned[s]) movable.push_back(s);
+        stable_sort(movable.begin(), movable.end(), [&](Step a, Step b) {return rank(a) < rank(b);});
+        size_t next = 0;
+        for (Step &s : order)
+            if (!pinned[s]) s = movable[next++];
+        for (StepStats &st : stats) {
+            st.calls /= 2;
+            st.rejections /= 2;
+            st.timedCalls /= 2;
+            st.timedNs /= 2;
+        }
+    }
+
+    bool adaptive = false;
+    array<Step, StepCount> order{Bank, Credit, Loan, Stock, Income};
+    array<bool, StepCount> pinned{};
+    array<StepStats, StepCount> stats{};
+    uint64_t applications = 0;
+};
+
+//Concrete MortgageLoanApp class which implements the
+//primitive operations.
+class MortgageLoanApp : public CheckBackground {
+public:
+    explicit MortgageLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() final {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return lookup(20, _data.bankBalance) && _data.bankBalance >= 1000;
+    }
+
+    bool checkCredit() final { //check score from 3 companies
+        int cScore = _data.creditScore;
+        bool good = lookup(3 * 80, cScore) && cScore > 700;
+        if (verbose) cout << "check credit... " << (good ? "GOOD\n" : "BAD\n");
+        return good;
+    }
+
+    bool checkLoan() final { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return lookup(60, _data.openLoans) && _data.openLoans <= 2;
+    }
+
+    bool checkStock() final { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return lookup(120, _data.stockValue) && _data.stockValue >= 0;
+    }
+
+    bool checkIncome() final { //check how much they make
+        if (verbose) cout << "check income..." << endl;
+        return lookup(10, _data.income) && _data.income >= 50000;
+    }
+};
+//Concrete EquityLoanApp class which implements the
+//primitive operations. checkIncome and checkCredit
+//differs from MortgageLoanApp's corresponding
+//methods.
+
+class EquityLoanApp : public CheckBackground {
+public:
+    explicit EquityLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() final {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return lookup(20, _data.bankBalance) && _data.bankBalance >= 1000;
+    }
+
+    bool checkCredit() final { //check score from 3 companies
+        int cScore = _data.creditScore;
+        bool good = lookup(3 * 80, cScore) && cScore > 600;
+        if (verbose) cout << "check credit... " << (good ? "GOOD\n" : "BAD\n");
+        return good;
+    }
+
+    bool checkLoan() final { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return lookup(60, _data.openLoans) && _data.openLoans <= 2;
+    }
+
+    bool checkStock() final { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return lookup(120, _data.stockValue) && _data.stockValue >= 0;
+    }
+
+    bool checkIncome() final { //check how much a family makes
+        if (verbose) cout << "check income..." << endl;
+        return lookup(10, _data.income) && _data.income >= 40000;
+    }
+};
+
+// Applicants from a population; skew picks which check rejects most.
+vector<Data> population(size_t count, bool lowIncome, uint32_t seed) {
+    mt19937 gen(seed);
+    lognormal_distribution<double> income(lowIncome ? 10.3 : 11.0, 0.4);
+    normal_distribution<double> credit(lowIncome ? 720 : 640, 60);
+    uniform_real_distribution<double> u(0, 1);
+    vector<Data> people(count);
+    for (Data &d : people) {
+        d.income = (int) income(gen);
+        d.creditScore = (int) credit(gen);
+        d.bankBalance = u(gen) < 0.03 ? 500 : 20000;
+        d.openLoans = u(gen) < 0.08 ? 3 : 1;
+        d.stockValue = u(gen) < 0.01 ? -1 : 5000;
+    }
+    return people;
+}
+
+double applicationsPerSecond(CheckBackground &app, const vector<Data> &people, size_t &accepted) {
+    accepted = 0;
+    auto start = chrono::steady_clock::now();
+    for (const Data &d : people) {
+        app.setData(d);
+        accepted += app.check();
+    }
+    return (double) people.size() / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//This is our test program.
+int main(int argc, char *argv[]){
+    CheckBackground *p = new MortgageLoanApp("Ahmet");
+    cout << "Check client " << p->getName() << " mortgage loan application" << endl;
+    p->check();
+
+    cout << endl;
+
+    p = new EquityLoanApp("Ahmet");
+    cout << "Check client " << p->getName() << " equity loan application" << endl;
+    p->check();
+
+    // Benchmark: fixed vs adaptive order on two skewed populations. The
+    // bank check is pinned first: nothing else runs without an account.
+    size_t count = argc > 1 ? stoul(argv[1]) : 2000000;
+    verbose = false;
+    for (bool lowIncome : {true, false}) {
+        vector<Data> people = population(count, lowIncome, 11);
+        cout << endl << count << " mortgage applications, "
+             << (lowIncome ? "mostly low income" : "mostly low credit") << endl;
+        MortgageLoanApp fixed("fixed"), adaptive("adaptive");
+        adaptive.setAdaptive(true);
+        adaptive.pin(CheckBackground::Bank);
+        size_t fixedAccepted, adaptiveAccepted;
+        double fixedRate = applicationsPerSecond(fixed, people, fixedAccepted);
+        double adaptiveRate = applicationsPerSecond(adaptive, people, adaptiveAccepted);
+        cout << "fixed order   : " << fixedRate << " applications/s, " << fixedAccepted << " accepted" << endl;
+        cout << "adaptive order: " << adaptiveRate << " applications/s, " << adaptiveAccepted << " accepted, order:";
+        for (auto step : adaptive.getOrder()) cout << " " << CheckBackground::stepName(step);
+        cout << endl;
+    }
+}
@@ -0,0 +1,497 @@
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+//============================================================================
+//Name        : TemplateMethodBatch.cpp
+//
+//TemplateMethod.cpp scoring whole applicant files instead of one constant
+//applicant:
+//1. AbstractClass  (CheckBackground), ConcreteClass (MortgageLoanApp,
+//			EquityLoanApp) as in TemplateMethodCRTP.cpp. Each concrete
+//			class publishes its thresholds as a LoanRule.
+//2. ApplicantTable
+//			Applicants by column: one contiguous int32 array per field.
+//			Loaded from CSV (a header row names the columns; unknown
+//			columns are skipped) or memory-mapped from a binary file
+//			whose columns are 64-byte aligned.
+//3. checkBatch
+//			Evaluates a LoanRule over a whole table into a bitmask, bit i
+//			set when applicant i is accepted. With AVX2 it compares eight
+//			applicants per instruction and packs the results with
+//			movemask; otherwise a scalar loop does the same.
+//
+//Usage:  TemplateMethodBatch                  demo, then benchmark 10M rows
+//        TemplateMethodBatch ROWS             benchmark ROWS rows
+//        TemplateMethodBatch csv FILE         score a CSV file
+//        TemplateMethodBatch binary FILE      score a binary file
+//============================================================================
+
+// When false, the checks print nothing. The benchmark turns it off.
+static bool verbose = true;
+
+class Data {
+public:
+    Data() = default;
+    Data(int income, int creditScore) : _income(income), _creditScore(creditScore) {}
+    int getIncome() const {return _income;}
+    int getCreditScore() const {return _creditScore;}
+private:
+    int _income = 50000;
+    int _creditScore = 650;
+};
+
+// Accepted when creditScore > creditAbove and income >= incomeAtLeast.
+struct LoanRule{
+    int32_t creditAbove;
+    int32_t incomeAtLeast;
+};
+
+//This is the AbstractClass class.
+
+class CheckBackground {
+public:
+    explicit CheckBackground(string name){_name = move(name);}
+    virtual ~CheckBackground() = default;
+    string getName() {return _name;}
+    void setData(const Data &data) {_data = data;}
+    //This is our template method.
+    bool check() {
+        prepareApplication();
+        bool status = checkBank() && checkCredit() && checkLoan()
+                    && checkStock() && checkIncome();
+        finalizeApplication(status);
+        return status;
+    }
+
+    // These are our concrete template operations.
+protected:
+    static void prepareApplication() {
+        if (verbose) cout << "Prepared Paperwork" << endl;
+    }
+    static void finalizeApplication(bool status) {
+        if (!verbose) return;
+        if (status){cout << "Application Accepted\n";}
+        else {cout << "Application Rejected\n";}
+    }
+    // These are Primitive Operations which will be overridden
+    // by the subclasses. They are all abstract.
+    string _name;
+    Data _data;
+    virtual bool checkBank() = 0;
+    virtual bool checkCredit() = 0;
+    virtual bool checkLoan() = 0;
+    virtual bool checkIncome() = 0;
+    virtual bool checkStock() = 0;
+};
+
+//Concrete MortgageLoanApp class which implements the
+//primitive operations.
+class MortgageLoanApp : public CheckBackground {
+public:
+    static constexpr LoanRule rule{700, 50000};
+    explicit MortgageLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() final {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return true;
+    }
+
+    bool checkCredit() final { //check score from 3 companies
+        int cScore = _data.getCreditScore();
+        if (verbose) cout << "check credit... " << ((cScore > rule.creditAbove) ? "GOOD\n" : "BAD\n");
+        return (cScore > rule.creditAbove);
+    }
+
+    bool checkLoan() final { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return true;
+    }
+
+    bool checkStock() final { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return true;
+    }
+
+    bool checkIncome() final { //check how much they make
+        if (verbose) cout << "check income..." << endl;
+        return (_data.getIncome() >= rule.incomeAtLeast);
+    }
+};
+//Concrete EquityLoanApp class which implements the
+//primitive operations. checkIncome and checkCredit
+//differs from MortgageLoanApp's corresponding
+//methods.
+
+class EquityLoanApp : public CheckBackground {
+public:
+    static constexpr LoanRule rule{600, 40000};
+    explicit EquityLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() final {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return true;
+    }
+
+    bool checkCredit() final { //check score from 3 companies
+        int cScore = _data.getCreditScore();
+        if (verbose) cout << "check credit... " << ((cScore > rule.creditAbove) ? "GOOD\n" : "BAD\n");
+        return (cScore > rule.creditAbove);
+    }
+
+    bool checkLoan() final { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return true;
+    }
+
+    bool checkStock() final { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return true;
+    }
+
+    bool checkIncome() final { //check how much a family makes
+        if (verbose) cout << "check income..." << endl;
+        return (_data.getIncome() >= rule.incomeAtLeast);
+    }
+};
+
+// Binary layout, little-endian as written by this program: a 64-byte
+// header, then the income column, then the credit score column, each an
+// int32 array starting at a multiple of 64 bytes.
+struct ApplicantHeader{
+    char magic[8];        // "APPL01\0\0"
+    uint32_t columnCount; // 2
+    uint32_t reserved;
+    uint64_t rowCount;
+    char padding[40];
+};
+static_assert(sizeof(ApplicantHeader) == 64);
+static const char ApplicantMagic[8] = "APPL01";
+
+class ApplicantTable{
+public:
+    ApplicantTable() = default;
+    ApplicantTable(ApplicantTable &&other) noexcept {swap(other);}
+    ApplicantTable &operator=(ApplicantTable &&other) noexcept {swap(other); return *this;}
+    ApplicantTable(const ApplicantTable &) = delete;
+    ApplicantTable &operator=(const ApplicantTable &) = delete;
+    ~ApplicantTable() {if (_mapped != nullptr) munmap(_mapped, _mappedSize);}
+
+    // Reads "income" and "credit_score" from a CSV file with a header row.
+    static ApplicantTable fromCsv(const string &path) {
+        ApplicantTable table;
+        FILE *in = fopen(path.c_str(), "rb");
+        if (in == nullptr) throw runtime_error("cannot open " + path);
+        string text;
+        char buffer[1 << 16];
+        size_t got;
+        while ((got = fread(buffer, 1, sizeof buffer, in)) > 0) text.append(buffer, got);
+        fclose(in);
+
+        string_view rest(text);
+        auto nextLine = [&rest] {
+            size_t end = rest.find('\n');
+            string_view line = rest.substr(0, end);
+            rest.remove_prefix(end == string_view::npos ? rest.size() : end + 1);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            return line;
+        };
+        int incomeAt = -1, creditAt = -1, columns = 0;
+        string_view header = nextLine();
+        for (size_t start = 0; start <= header.size(); columns++) {
+            size_t end = min(header.find(',', start), header.size());
+            string_view name = header.substr(start, end - start);
+            if (name == "income") incomeAt = columns;
+            else if (name == "credit_score") creditAt = columns;
+            start = end + 1;
+        }
+        if (incomeAt < 0 || creditAt < 0) throw runtime_error(path + ": needs income and credit_score columns");
+
+        size_t lineNumber = 1;
+        while (!rest.empty()) {
+            string_view line = nextLine();
+            lineNumber++;
+            if (line.empty()) continue;
+            int32_t income = 0, credit = 0;
+            int found = 0, column = 0;
+            for (size_t start = 0; start <= line.size() && column < columns; column++) {
+                size_t end = min(line.find(',', start), line.size());
+                if (column == incomeAt || column == creditAt) {
+                    int32_t &field = column == incomeAt ? income : credit;
+                    auto [ptr, ec] = from_chars(line.data() + start, line.data() + end, field);
+                    if (ec != errc() || ptr != line.data() + end)
+                        throw runtime_error(path + ":" + to_string(lineNumber) + ": bad number");
+                    found++;
+                }
+                start = end + 1;
+            }
+            if (found != 2) throw runtime_error(path + ":" + to_string(lineNumber) + ": missing column");
+            table.add(income, credit);
+        }
+        return table;
+    }
+
+    // Maps a file written by writeBinary; the columns are used in place.
+    static ApplicantTable mapBinary(const string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("cannot open " + path);
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw runtime_error("cannot stat " + path);
+        }
+        auto size = (size_t) st.st_size;
+        if (size < sizeof(ApplicantHeader)) {
+            close(fd);
+            throw runtime_error(path + " is not an applicant file");
+        }
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) throw runtime_error("cannot map " + path);
+
+        ApplicantTable table;
+        table._mapped = data;
+        table._mappedSize = size;
+        auto *header = static_cast<const ApplicantHeader *>(data);
+        uint64_t rows = header->rowCount;
+        // rowCount is checked before it goes into any size computation
+        if (memcmp(header->magic, ApplicantMagic, 8) != 0 || header->columnCount != 2
+            || rows > (size - sizeof(ApplicantHeader)) / (2 * sizeof(int32_t))
+            || size < columnOffset(2, rows))
+            throw runtime_error(path + " is not an applicant file or is truncated"); // table unmaps
+        auto *bytes = static_cast<const char *>(data);
+        table._incomeView = {reinterpret_cast<const int32_t *>(bytes + columnOffset(0, rows)), rows};
+        table._creditView = {reinterpret_cast<const int32_t *>(bytes + columnOffset(1, rows)), rows};
+        return table;
+    }
+
+    void add(int32_t income, int32_t creditScore) {
+        if (_mapped != nullptr) throw logic_error("a mapped table is read-only");
+        _income.push_back(income);
+        _creditScore.push_back(creditScore);
+    }
+
+    size_t size() const {return income().size();}
+    span<const int32_t> income() const {return _mapped ? _incomeView : span<const int32_t>(_income);}
+    span<const int32_t> creditScore() const {return _mapped ? _creditView : span<const int32_t>(_creditScore);}
+    Data row(size_t i) const {return {income()[i], creditScore()[i]};}
+
+    void writeCsv(const string &path) const {
+        FILE *out = fopen(path.c_str(), "wb");
+        if (out == nullptr) throw runtime_error("cannot create " + path);
+        fputs("income,credit_score\n", out);
+        for (size_t i = 0; i < size(); i++) fprintf(out, "%d,%d\n", income()[i], creditScore()[i]);
+        finishWrite(out, path);
+    }
+
+    void writeBinary(const string &path) const {
+        FILE *out = fopen(path.c_str(), "wb");
+        if (out == nullptr) throw runtime_error("cannot create " + path);
+        ApplicantHeader header{};
+        memcpy(header.magic, ApplicantMagic, 8);
+        header.columnCount = 2;
+        header.rowCount = size();
+        fwrite(&header, sizeof header, 1, out);
+        static const char zeros[64] = {};
+        for (span<const int32_t> column : {income(), creditScore()}) {
+            fwrite(column.data(), sizeof(int32_t), column.size(), out);
+            fwrite(zeros, 1, columnBytes(size()) - column.size_bytes(), out);
+        }
+        finishWrite(out, path);
+    }
+
+private:
+    // A failed fwrite/fprintf sets the stream's error flag, which fclose
+    // does not report; check it first.
+    static void finishWrite(FILE *out, const string &path) {
+        bool failed = fflush(out) != 0 || ferror(out) != 0;
+        if (fclose(out) != 0 || failed) throw runtime_error("short write to " + path);
+    }
+
+    static size_t columnBytes(size_t rows) {return (rows * sizeof(int32_t) + 63) / 64 * 64;}
+    static size_t columnOffset(int column, size_t rows) {
+        return sizeof(ApplicantHeader) + (size_t) column * columnBytes(rows);
+    }
+
+    void swap(ApplicantTable &other) noexcept {
+        std::swap(_income, other._income);
+        std::swap(_creditScore, other._creditScore);
+        std::swap(_mapped, other._mapped);
+        std::swap(_mappedSize, other._mappedSize);
+        std::swap(_incomeView, other._incomeView);
+        std::swap(_creditView, other._creditView);
+    }
+
+    vector<int32_t> _income, _creditScore; // when loaded from CSV or built
+    void *_mapped = nullptr;               // when mapped from a binary file
+    size_t _mappedSize = 0;
+    span<const int32_t> _incomeView, _creditView;
+};
+
+// Writes (n + 63) / 64 words.
+void checkScalar(const int32_t *income, const int32_t *credit, size_t n, LoanRule rule, uint64_t *mask) {
+    for (size_t w = 0; w * 64 < n; w++) {
+        uint64_t bits = 0;
+        size_t end = min(n, w * 64 + 64);
+        for (size_t i = w * 64; i < end; i++)
+            bits |= (uint64_t) ((credit[i] > rule.creditAbove) & (income[i] >= rule.incomeAtLeast)) << (i % 64);
+        mask[w] = bits;
+    }
+}
+
+// 64 applicants per mask word, eight per compare; the tail goes to checkScalar.
+__attribute__((target("avx2")))
+void checkAvx2(const int32_t *income, const int32_t *credit, size_t n, LoanRule rule, uint64_t *mask) {
+    const __m256i creditAbove = _mm256_set1_epi32(rule.creditAbove);
+    const __m256i incomeAbove = _mm256_set1_epi32(rule.incomeAtLeast - 1);
+    size_t words = n / 64;
+    for (size_t w = 0; w < words; w++) {
+        uint64_t bits = 0;
+        for (int k = 0; k < 8; k++) {
+            size_t i = w * 64 + k * 8;
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(credit + i));
+            __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(income + i));
+            __m256i ok = _mm256_and_si256(_mm256_cmpgt_epi32(c, creditAbove), _mm256_cmpgt_epi32(m, incomeAbove));
+            bits |= (uint64_t) (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(ok)) << (k * 8);
+        }
+        mask[w] = bits;
+    }
+    checkScalar(income + words * 64, credit + words * 64, n - words * 64, rule, mask + words);
+}
+
+static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+
+// Bit i % 64 of mask[i / 64] is set when applicant i passes rule.
+void checkBatch(const ApplicantTable &table, LoanRule rule, vector<uint64_t> &mask, bool simd = true) {
+    mask.resize((table.size() + 63) / 64);
+    if (simd && hasAvx2) checkAvx2(table.income().data(), table.creditScore().data(), table.size(), rule, mask.data());
+    else checkScalar(table.income().data(), table.creditScore().data(), table.size(), rule, mask.data());
+}
+
+size_t accepted(const vector<uint64_t> &mask) {
+    size_t count = 0;
+    for (uint64_t word : mask) count += (size_t) __builtin_popcountll(word);
+    return count;
+}
+
+void score(const ApplicantTable &table) {
+    vector<uint64_t> mortgage, equity;
+    checkBatch(table, MortgageLoanApp::rule, mortgage);
+    checkBatch(table, EquityLoanApp::rule, equity);
+    cout << table.size() << " applicants: " << accepted(mortgage) << " mortgage and "
+         << accepted(equity) << " equity loans accepted" << endl;
+}
+
+template <typename F>
+double bestOf(int runs, F f) {
+    double best = 1e300;
+    for (int r = 0; r < runs; r++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+double secondsOf(const chrono::steady_clock::time_point &start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//This is our test program.
+int main(int argc, char *argv[]){
+    try {
+        if (argc >= 3 && string(argv[1]) == "csv") {
+            score(ApplicantTable::fromCsv(argv[2]));
+            return 0;
+        }
+        if (argc >= 3 && string(argv[1]) == "binary") {
+            score(ApplicantTable::mapBinary(argv[2]));
+            return 0;
+        }
+
+        // Demo: three applicants from a CSV file, one at a time, then as a batch
+        string csvPath = "/tmp/TemplateMethodBatch.csv", binaryPath = "/tmp/TemplateMethodBatch.bin";
+        if (argc < 2) {
+            FILE *out = fopen(csvPath.c_str(), "wb");
+            if (out == nullptr) throw runtime_error("cannot create " + csvPath);
+            fputs("name,income,credit_score\nAhmet,50000,650\nAyse,72000,760\nMehmet,38000,720\n", out);
+            fclose(out);
+            ApplicantTable demo = ApplicantTable::fromCsv(csvPath);
+            MortgageLoanApp mortgage("Ahmet");
+            for (size_t i = 0; i < demo.size(); i++) {
+                cout << "Check applicant " << i << " mortgage loan application" << endl;
+                mortgage.setData(demo.row(i));
+                mortgage.check();
+                cout << endl;
+            }
+            score(demo);
+        }
+
+        // Benchmark: one template method call per applicant vs checkBatch
+        size_t count = argc > 1 ? stoul(argv[1]) : 10000000;
+        verbose = false;
+        mt19937 gen(7);
+        uniform_int_distribution<int> income(20000, 120000), credit(450, 850);
+        ApplicantTable built;
+        for (size_t i = 0; i < count; i++) {
+            int32_t inc = income(gen);
+            built.add(inc, credit(gen));
+        }
+        built.writeCsv(csvPath);
+        built.writeBinary(binaryPath);
+        auto start = chrono::steady_clock::now();
+        ApplicantTable fromCsv = ApplicantTable::fromCsv(csvPath);
+        double csvSeconds = secondsOf(start);
+        start = chrono::steady_clock::now();
+        ApplicantTable table = ApplicantTable::mapBinary(binaryPath);
+        double mapSeconds = secondsOf(start);
+        cout << endl << count << " applicants; load from CSV " << csvSeconds << " s, map binary "
+             << mapSeconds << " s" << endl;
+        if (fromCsv.size() != count) throw runtime_error("CSV round trip lost rows");
+
+        MortgageLoanApp mortgage("mortgage");
+        EquityLoanApp equity("equity");
+        pair<CheckBackground *, LoanRule> apps[] = {{&mortgage, MortgageLoanApp::rule},
+                                                    {&equity, EquityLoanApp::rule}};
+        for (auto [app, rule] : apps) {
+            size_t perObject = 0;
+            double objectSeconds = bestOf(3, [&] {
+                perObject = 0;
+                for (size_t i = 0; i < table.size(); i++) {
+                    app->setData(table.row(i));
+                    perObject += app->check();
+                }
+            });
+            vector<uint64_t> scalarMask, simdMask;
+            double scalarSeconds = bestOf(3, [&] {checkBatch(table, rule, scalarMask, false);});
+            double simdSeconds = bestOf(3, [&] {checkBatch(table, rule, simdMask);});
+            if (accepted(scalarMask) != perObject || simdMask != scalarMask)
+                throw runtime_error("batch and template method disagree");
+            cout << app->getName() << ": " << perObject << " accepted" << endl;
+            cout << "  template method per object: " << (double) count / objectSeconds << " applicants/s" << endl;
+            cout << "  checkBatch, scalar         : " << (double) count / scalarSeconds << " applicants/s" << endl;
+            cout << "  checkBatch, " << (hasAvx2 ? "AVX2  " : "scalar") << "         : "
+                 << (double) count / simdSeconds << " applicants/s" << endl;
+        }
+        unlink(csvPath.c_str());
+        unlink(binaryPath.c_str());
+    }
+    catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
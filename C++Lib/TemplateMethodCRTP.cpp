@@ -0,0 +1,305 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+//============================================================================
+//Name        : TemplateMethodCRTP.cpp
+//
+//TemplateMethod.cpp with the primitive operations bound at compile time:
+//1. AbstractClass  (crtp::CheckBackground<Derived>)
+//			The same check() skeleton and short-circuit order. It calls
+//			the primitive operations through static_cast<Derived*>, so
+//			they can be inlined into the template method; there is no
+//			vtable.
+//2. ConcreteClass  (crtp::MortgageLoanApp, crtp::EquityLoanApp)
+//			The same primitive operations as in TemplateMethod.cpp.
+//
+//The virtual version is kept alongside for the benchmark. Both read the
+//applicant from a Data object instead of TemplateMethod.cpp's constants,
+//so the benchmark can feed them different applicants.
+//============================================================================
+
+// When false, the checks print nothing. The benchmark turns it off.
+static bool verbose = true;
+
+class Data {
+public:
+    Data() = default;
+    Data(int income, int creditScore) : _income(income), _creditScore(creditScore) {}
+    int getIncome() const {return _income;}
+    int getCreditScore() const {return _creditScore;}
+private:
+    int _income = 50000;
+    int _creditScore = 650;
+};
+
+//This is the AbstractClass class, with virtual primitive operations.
+
+class CheckBackground {
+public:
+    explicit CheckBackground(string name){_name = move(name);}
+    virtual ~CheckBackground() = default;
+    string getName() {return _name;}
+    void setData(const Data &data) {_data = data;}
+    //This is our template method.
+    bool check() {
+        prepareApplication();
+        bool status = checkBank() && checkCredit() && checkLoan()
+                    && checkStock() && checkIncome();
+        finalizeApplication(status);
+        return status;
+    }
+
+    // These are our concrete template operations.
+protected:
+    static void prepareApplication() {
+        if (verbose) cout << "Prepared Paperwork" << endl;
+    }
+    static void finalizeApplication(bool status) {
+        if (!verbose) return;
+        if (status){cout << "Application Accepted\n";}
+        else {cout << "Application Rejected\n";}
+    }
+    // These are Primitive Operations which will be overridden
+    // by the subclasses. They are all abstract.
+    string _name;
+    Data _data;
+    virtual bool checkBank() = 0;
+    virtual bool checkCredit() = 0;
+    virtual bool checkLoan() = 0;
+    virtual bool checkIncome() = 0;
+    virtual bool checkStock() = 0;
+};
+
+class MortgageLoanApp : public CheckBackground {
+public:
+    explicit MortgageLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() final {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return true;
+    }
+
+    bool checkCredit() final { //check score from 3 companies
+        int cScore = _data.getCreditScore();
+        if (verbose) cout << "check credit... " << ((cScore > 700) ? "GOOD\n" : "BAD\n");
+        return (cScore > 700);
+    }
+
+    bool checkLoan() final { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return true;
+    }
+
+    bool checkStock() final { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return true;
+    }
+
+    bool checkIncome() final { //check how much they make
+        if (verbose) cout << "check income..." << endl;
+        return (_data.getIncome() >= 50000);
+    }
+};
+
+class EquityLoanApp : public CheckBackground {
+public:
+    explicit EquityLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() final {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return true;
+    }
+
+    bool checkCredit() final { //check score from 3 companies
+        int cScore = _data.getCreditScore();
+        if (verbose) cout << "check credit... " << ((cScore > 600) ? "GOOD\n" : "BAD\n");
+        return (cScore > 600);
+    }
+
+    bool checkLoan() final { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return true;
+    }
+
+    bool checkStock() final { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return true;
+    }
+
+    bool checkIncome() final { //check how much a family makes
+        if (verbose) cout << "check income..." << endl;
+        return (_data.getIncome() >= 40000);
+    }
+};
+
+namespace crtp {
+
+//This is the AbstractClass class. Derived supplies the primitive
+//operations; they are found at compile time.
+
+template <typename Derived>
+class CheckBackground {
+public:
+    explicit CheckBackground(string name){_name = move(name);}
+    string getName() {return _name;}
+    void setData(const Data &data) {_data = data;}
+    //This is our template method.
+    bool check() {
+        prepareApplication();
+        Derived &self = derived();
+        bool status = self.checkBank() && self.checkCredit() && self.checkLoan()
+                    && self.checkStock() && self.checkIncome();
+        finalizeApplication(status);
+        return status;
+    }
+
+    // These are our concrete template operations.
+protected:
+    static void prepareApplication() {
+        if (verbose) cout << "Prepared Paperwork" << endl;
+    }
+    static void finalizeApplication(bool status) {
+        if (!verbose) return;
+        if (status){cout << "Application Accepted\n";}
+        else {cout << "Application Rejected\n";}
+    }
+    string _name;
+    Data _data;
+
+private:
+    Derived &derived() {return static_cast<Derived &>(*this);}
+};
+
+// The primitive operations are protected; the base reaches them as a friend.
+class MortgageLoanApp : public CheckBackground<MortgageLoanApp> {
+    friend class CheckBackground<MortgageLoanApp>;
+public:
+    explicit MortgageLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return true;
+    }
+
+    bool checkCredit() { //check score from 3 companies
+        int cScore = _data.getCreditScore();
+        if (verbose) cout << "check credit... " << ((cScore > 700) ? "GOOD\n" : "BAD\n");
+        return (cScore > 700);
+    }
+
+    bool checkLoan() { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return true;
+    }
+
+    bool checkStock() { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return true;
+    }
+
+    bool checkIncome() { //check how much they make
+        if (verbose) cout << "check income..." << endl;
+        return (_data.getIncome() >= 50000);
+    }
+};
+
+class EquityLoanApp : public CheckBackground<EquityLoanApp> {
+    friend class CheckBackground<EquityLoanApp>;
+public:
+    explicit EquityLoanApp(string name) : CheckBackground(move(name)) {}
+protected:
+    bool checkBank() {//check acct, balance
+        if (verbose) cout << "check bank... \n";
+        return true;
+    }
+
+    bool checkCredit() { //check score from 3 companies
+        int cScore = _data.getCreditScore();
+        if (verbose) cout << "check credit... " << ((cScore > 600) ? "GOOD\n" : "BAD\n");
+        return (cScore > 600);
+    }
+
+    bool checkLoan() { // check other loan info
+        if (verbose) cout << "check other loan..." << endl;
+        return true;
+    }
+
+    bool checkStock() { //check how many stock values
+        if (verbose) cout << "check stock values..." << endl;
+        return true;
+    }
+
+    bool checkIncome() { //check how much a family makes
+        if (verbose) cout << "check income..." << endl;
+        return (_data.getIncome() >= 40000);
+    }
+};
+
+} // namespace crtp
+
+template <typename F>
+double bestOf(int runs, F f) {
+    double best = 1e300;
+    for (int r = 0; r < runs; r++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+//This is our test program.
+int main(int argc, char *argv[]){
+    crtp::MortgageLoanApp mortgage("Ahmet");
+    cout << "Check client " << mortgage.getName() << " mortgage loan application" << endl;
+    mortgage.check();
+
+    cout << endl;
+
+    crtp::EquityLoanApp equity("Ahmet");
+    cout << "Check client " << equity.getName() << " equity loan application" << endl;
+    equity.check();
+
+    // Benchmark: applications/s, every other one a mortgage, output off
+    size_t count = argc > 1 ? stoul(argv[1]) : 10000000;
+    verbose = false;
+    mt19937 gen(7);
+    uniform_int_distribution<int> income(20000, 120000), credit(450, 850);
+    vector<Data> applicants;
+    applicants.reserve(count);
+    for (size_t i = 0; i < count; i++) applicants.emplace_back(income(gen), credit(gen));
+
+    MortgageLoanApp virtualMortgage("Ahmet");
+    EquityLoanApp virtualEquity("Ahmet");
+    CheckBackground *apps[] = {&virtualMortgage, &virtualEquity};
+    size_t virtualAccepted = 0, crtpAccepted = 0;
+    double virtualSeconds = bestOf(3, [&] {
+        virtualAccepted = 0;
+        for (size_t i = 0; i < count; i++) {
+            CheckBackground *p = apps[i & 1];
+            p->setData(applicants[i]);
+            virtualAccepted += p->check();
+        }
+    });
+    double crtpSeconds = bestOf(3, [&] {
+        crtpAccepted = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (i & 1) {
+                equity.setData(applicants[i]);
+                crtpAccepted += equity.check();
+            }
+            else {
+                mortgage.setData(applicants[i]);
+                crtpAccepted += mortgage.check();
+            }
+        }
+    });
+    cout << endl << count << " applications" << endl;
+    cout << "virtual primitive operations: " << (double) count / virtualSeconds << " applications/s, "
+         << virtualAccepted << " accepted" << endl;
+    cout << "CRTP primitive operations   : " << (double) count / crtpSeconds << " applications/s, "
+         << crtpAccepted << " accepted" << endl;
+}
@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : VisitorSoA.cpp
+//
+//VisitorPattern.cpp with the employees stored column by column, for
+//visitors that touch one field of every employee:
+//1. ObjectStructure  (soa::Employees)
+//	 One array per field: id, income, vacation days and a one-byte role
+//	 tag (Clerk, Director, President). groupByRole() reorders the rows so
+//	 each role is one contiguous range; ids travel with their rows.
+//2. Visitor  (soa::ColumnVisitor)
+//	 Visit(Employees&) is called once per table, not once per employee.
+//3. ConcreteVisitor  (soa::IncomeVisitor, soa::VacationVisitor)
+//	 Apply the per-role raise (x1.1 / x1.5 / x2.0) or extra vacation days
+//	 (+3 / +5 / +7) to a whole column. Kernel picks how:
+//	 Lookup  - per row, the role indexes a small table.
+//	 Simd    - AVX2, rows in any order. Income picks the factor with two
+//	           blends; vacation days look up the increment for eight rows
+//	           at once with a register permute.
+//	 PerRole - on a grouped table, one loop per role range with a
+//	           constant factor or increment, no role tags read.
+//	 Without AVX2, both SIMD kernels fall back to plain loops.
+//
+//The virtual double dispatch of VisitorPattern.cpp, one Accept per
+//employee, is repeated for the benchmark. Its elements are taken by
+//reference here, so only the dispatch is measured, not the copies
+//(VisitorVariant.cpp measures those).
+//============================================================================
+
+// When false, visitors print nothing. The benchmark turns it off.
+static bool verbose = true;
+
+enum class Role : uint8_t {Clerk, Director, President};
+constexpr size_t RoleCount = 3;
+constexpr double IncomeFactor[RoleCount] = {1.1, 1.50, 2.0};
+constexpr int32_t ExtraVacationDays[RoleCount] = {3, 5, 7};
+
+//forward declarations:
+class Clerk;
+class Director;
+class President;
+
+//"Visitor"
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+    virtual void Visit(Clerk &element) = 0;
+    virtual void Visit(Director &element) = 0;
+    virtual void Visit(President &element) = 0;
+};
+
+// Element  (Element)
+class Element{
+public:
+    virtual ~Element() = default;
+    virtual void Accept(Visitor* visitor) = 0;
+};
+
+//ConcreteElement  (Employee); the name is left out so that millions fit
+class Employee : public Element{
+public:
+    Employee(double income, int vacationDays) : income(income), vacationDays(vacationDays) {}
+    double income;
+    int vacationDays;
+};
+
+class Clerk : public Employee {
+public:
+    using Employee::Employee;
+    void Accept(Visitor *visitor) final {visitor->Visit(*this);};
+};
+
+class Director : public Employee {
+public:
+    using Employee::Employee;
+    void Accept(Visitor *visitor) final {visitor->Visit(*this);};
+};
+
+class President : public Employee {
+public:
+    using Employee::Employee;
+    void Accept(Visitor *visitor) final {visitor->Visit(*this);};
+};
+
+// ObjectStructure  (Employees)
+class Employees{
+public:
+    ~Employees() {for (Employee *employee : employees) delete employee;}
+    void Add(Employee *employee) {employees.push_back(employee);}
+    void Accept(Visitor *visitor){
+        for (auto & employee : employees){
+            employee->Accept(visitor);
+        }
+    }
+private:
+    vector<Employee *> employees;
+};
+
+// "ConcreteVisitor 1"
+class IncomeVisitor : public Visitor {
+public:
+    void Visit(Clerk &element) final {element.income *= IncomeFactor[0];}
+    void Visit(Director &element) final {element.income *= IncomeFactor[1];}
+    void Visit(President &element) final {element.income *= IncomeFactor[2];}
+};
+
+// "ConcreteVisitor 2"
+class VacationVisitor : public Visitor {
+public:
+    void Visit(Clerk &element) final {element.vacationDays += ExtraVacationDays[0];}
+    void Visit(Director &element) final {element.vacationDays += ExtraVacationDays[1];}
+    void Visit(President &element) final {element.vacationDays += ExtraVacationDays[2];}
+};
+
+namespace soa {
+
+class Employees;
+
+//"Visitor"
+class ColumnVisitor {
+public:
+    virtual ~ColumnVisitor() = default;
+    virtual void Visit(Employees &employees) = 0;
+};
+
+// ObjectStructure  (Employees)
+class Employees{
+public:
+    void reserve(size_t count) {
+        _id.reserve(count);
+        _income.reserve(count);
+        _vacationDays.reserve(count);
+        _role.reserve(count);
+    }
+    // Returns the new employee's id.
+    uint32_t Add(Role role, double income, int32_t vacationDays) {
+        auto id = (uint32_t) _id.size();
+        _id.push_back(id);
+        _income.push_back(income);
+        _vacationDays.push_back(vacationDays);
+        _role.push_back(role);
+        _grouped = false;
+        return id;
+    }
+    void Accept(ColumnVisitor *visitor) {visitor->Visit(*this);}
+
+    // Counting sort by role; stable, so ids stay ascending within a role.
+    // Each column is moved on its own to keep the extra memory to one column.
+    void groupByRole() {
+        size_t n = size();
+        array<size_t, RoleCount + 1> next{};
+        for (Role r : _role) next[(size_t) r + 1]++;
+        for (size_t r = 0; r < RoleCount; r++) next[r + 1] += next[r];
+        _roleBegin = next;
+        vector<uint32_t> destination(n);
+        for (size_t i = 0; i < n; i++) destination[i] = (uint32_t) next[(size_t) _role[i]]++;
+        scatter(_id, destination);
+        scatter(_income, destination);
+        scatter(_vacationDays, destination);
+        scatter(_role, destination);
+        _grouped = true;
+    }
+    bool grouped() const {return _grouped;}
+    // Rows [first, second) hold role; only valid while grouped().
+    pair<size_t, size_t> rowsOf(Role role) const {
+        return {_roleBegin[(size_t) role], _roleBegin[(size_t) role + 1]};
+    }
+
+    size_t size() const {return _id.size();}
+    span<const uint32_t> id() const {return _id;}
+    span<double> income() {return _income;}
+    span<const double> income() const {return _income;}
+    span<int32_t> vacationDays() {return _vacationDays;}
+    span<const int32_t> vacationDays() const {return _vacationDays;}
+    span<const Role> role() const {return _role;}
+
+private:
+    template <typename T>
+    static void scatter(vector<T> &column, const vector<uint32_t> &destination) {
+        vector<T> moved(column.size());
+        for (size_t i = 0; i < column.size(); i++) moved[destination[i]] = column[i];
+        column.swap(moved);
+    }
+
+    vector<uint32_t> _id;
+    vector<double> _income;
+    vector<int32_t> _vacationDays;
+    vector<Role> _role;
+    array<size_t, RoleCount + 1> _roleBegin{};
+    bool _grouped = false;
+};
+
+enum class Kernel {Lookup, Simd, PerRole};
+
+const char *kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Lookup: return "lookup";
+        case Kernel::Simd: return "SIMD";
+        case Kernel::PerRole: return "per role";
+    }
+    return "?";
+}
+
+static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+
+void scaleIncomeLookup(double *income, const Role *role, size_t n) {
+    for (size_t i = 0; i < n; i++) income[i] *= IncomeFactor[(size_t) role[i]];
+}
+
+// Four rows per step: widen the role bytes, compare against Director and
+// President, and blend the three broadcast factors.
+__attribute__((target("avx2")))
+void scaleIncomeAvx2(double *income, const Role *role, size_t n) {
+    const __m256d clerk = _mm256_set1_pd(IncomeFactor[0]);
+    const __m256d director = _mm256_set1_pd(IncomeFactor[1]);
+    const __m256d president = _mm256_set1_pd(IncomeFactor[2]);
+    const __m128i isDirector = _mm_set1_epi32((int) Role::Director);
+    const __m128i isPresident = _mm_set1_epi32((int) Role::President);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t tags;
+        memcpy(&tags, role + i, sizeof tags);
+        __m128i r = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(tags));
+        __m256d d = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(r, isDirector)));
+        __m256d p = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(r, isPresident)));
+        __m256d factor = _mm256_blendv_pd(_mm256_blendv_pd(clerk, director, d), president, p);
+        _mm256_storeu_pd(income + i, _mm256_mul_pd(_mm256_loadu_pd(income + i), factor));
+    }
+    scaleIncomeLookup(income + i, role + i, n - i);
+}
+
+void addVacationLookup(int32_t *days, const Role *role, size_t n) {
+    for (size_t i = 0; i < n; i++) days[i] += ExtraVacationDays[(size_t) role[i]];
+}
+
+// Eight rows per step: the role bytes index the increment table, held in
+// one register, through a permute.
+__attribute__((target("avx2")))
+void addVacationAvx2(int32_t *days, const Role *role, size_t n) {
+    const __m256i table = _mm256_setr_epi32(ExtraVacationDays[0], ExtraVacationDays[1], ExtraVacationDays[2],
+                                            0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i r = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(role + i)));
+        __m256i extra = _mm256_permutevar8x32_epi32(table, r);
+        auto *p = reinterpret_cast<__m256i *>(days + i);
+        _mm256_storeu_si256(p, _mm256_add_epi32(_mm256_loadu_si256(p), extra));
+    }
+    addVacationLookup(days + i, role + i, n - i);
+}
+
+// Kernels for one role's range. GCC 12 does not vectorize these loops at
+// -O2, so the AVX2 versions are spelled out.
+__attribute__((target("avx2")))
+void scaleRangeAvx2(double *income, size_t n, double factor) {
+    const __m256d f = _mm256_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(income + i, _mm256_mul_pd(_mm256_loadu_pd(income + i), f));
+    for (; i < n; i++) income[i] *= factor;
+}
+void scaleRange(double *income, size_t n, double factor) {
+    if (hasAvx2) scaleRangeAvx2(income, n, factor);
+    else for (size_t i = 0; i < n; i++) income[i] *= factor;
+}
+
+__attribute__((target("avx2")))
+void addRangeAvx2(int32_t *days, size_t n, int32_t extra) {
+    const __m256i e = _mm256_set1_epi32(extra);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto *p = reinterpret_cast<__m256i *>(days + i);
+        _mm256_storeu_si256(p, _mm256_add_epi32(_mm256_loadu_si256(p), e));
+    }
+    for (; i < n; i++) days[i] += extra;
+}
+void addRange(int32_t *days, size_t n, int32_t extra) {
+    if (hasAvx2) addRangeAvx2(days, n, extra);
+    else for (size_t i = 0; i < n; i++) days[i] += extra;
+}
+
+// "ConcreteVisitor 1"
+class IncomeVisitor : public ColumnVisitor {
+public:
+    explicit IncomeVisitor(Kernel kernel = Kernel::Simd) : _kernel(kernel) {}
+    void Visit(Employees &employees) final {
+        span<double> income = employees.income();
+        const Role *role = employees.role().data();
+        if (_kernel == Kernel::PerRole && employees.grouped()) {
+            for (size_t r = 0; r < RoleCount; r++) {
+                auto [first, last] = employees.rowsOf((Role) r);
+                scaleRange(income.data() + first, last - first, IncomeFactor[r]);
+            }
+        }
+        else if (_kernel != Kernel::Lookup && hasAvx2) scaleIncomeAvx2(income.data(), role, income.size());
+        else scaleIncomeLookup(income.data(), role, income.size());
+        if (verbose)
+            for (size_t i = 0; i < employees.size(); i++)
+                cout << "Employee " << employees.id()[i] << "'s new income: " << income[i] << endl;
+    }
+private:
+    Kernel _kernel;
+};
+
+// "ConcreteVisitor 2"
+class VacationVisitor : public ColumnVisitor {
+public:
+    explicit VacationVisitor(Kernel kernel = Kernel::Simd) : _kernel(kernel) {}
+    void Visit(Employees &employees) final {
+        span<int32_t> days = employees.vacationDays();
+        const Role *role = employees.role().data();
+        if (_kernel == Kernel::PerRole && employees.grouped()) {
+            for (size_t r = 0; r < RoleCount; r++) {
+                auto [first, last] = employees.rowsOf((Role) r);
+                addRange(days.data() + first, last - first, ExtraVacationDays[r]);
+            }
+        }
+        else if (_kernel != Kernel::Lookup && hasAvx2) addVacationAvx2(days.data(), role, days.size());
+        else addVacationLookup(days.data(), role, days.size());
+        if (verbose)
+            for (size_t i = 0; i < employees.size(); i++)
+                cout << "Employee " << employees.id()[i] << "'s new vacation days: " << days[i] << endl;
+    }
+private:
+    Kernel _kernel;
+};
+
+} // namespace soa
+
+// Roles for the benchmark: 80% clerks, 15% directors, 5% presidents.
+Role roleOf(uint64_t &state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    uint64_t x = ((state * 0x2545F4914F6CDD1Dull) >> 32) % 100;
+    return x < 80 ? Role::Clerk : x < 95 ? Role::Director : Role::President;
+}
+double baseIncome(Role role) {return 200000.0 + 100000.0 * (double) role;}
+int32_t baseVacation(Role role) {return 10 + 10 * (int32_t) role;}
+
+template <typename F>
+double seconds(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Sums by id, so tables in different row orders compare equal.
+bool sameEmployees(const soa::Employees &a, const soa::Employees &b) {
+    if (a.size() != b.size()) return false;
+    vector<double> income(a.size());
+    vector<int32_t> days(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        income[a.id()[i]] = a.income()[i];
+        days[a.id()[i]] = a.vacationDays()[i];
+    }
+    for (size_t i = 0; i < b.size(); i++)
+        if (income[b.id()[i]] != b.income()[i] || days[b.id()[i]] != b.vacationDays()[i]) return false;
+    return true;
+}
+
+int main(int argc, char *argv[]){
+    //Setup Employee Collection
+    soa::Employees e;
+    e.Add(Role::Clerk, 200000, 10);
+    e.Add(Role::Director, 300000, 20);
+    e.Add(Role::President, 400000, 30);
+
+    //Employees are 'visited'
+    soa::IncomeVisitor income;
+    soa::VacationVisitor vacation;
+    e.Accept(&income);
+    e.Accept(&vacation);
+
+    // Benchmark: one IncomeVisitor and one VacationVisitor pass over N
+    // employees (default 100M) per kernel; the virtual version over M
+    // (default 10M), since 100M heap objects do not fit in a few GB.
+    size_t count = argc > 1 ? stoul(argv[1]) : 100000000;
+    size_t virtualCount = argc > 2 ? stoul(argv[2]) : min<size_t>(count, 10000000);
+    verbose = false;
+
+    // all kernels agree on a small table, including its odd-sized tail
+    {
+        soa::Employees tables[3];
+        uint64_t state = 5;
+        for (size_t i = 0; i < 10007; i++) {
+            Role role = roleOf(state);
+            for (auto &t : tables) t.Add(role, baseIncome(role) + (double) i, baseVacation(role));
+        }
+        tables[2].groupByRole();
+        for (soa::Kernel kernel : {soa::Kernel::Lookup, soa::Kernel::Simd, soa::Kernel::PerRole}) {
+            soa::IncomeVisitor raise(kernel);
+            soa::VacationVisitor extra(kernel);
+            tables[(int) kernel].Accept(&raise);
+            tables[(int) kernel].Accept(&extra);
+        }
+        if (!sameEmployees(tables[0], tables[1]) || !sameEmployees(tables[0], tables[2])) {
+            cerr << "kernels disagree" << endl;
+            return 1;
+        }
+    }
+
+    soa::Employees table;
+    double build = seconds([&] {
+        table.reserve(count);
+        uint64_t state = 1;
+        for (size_t i = 0; i < count; i++) {
+            Role role = roleOf(state);
+            table.Add(role, baseIncome(role), baseVacation(role));
+        }
+    });
+    cout << endl << count << " employees in columns, built in " << build << " s" << endl;
+
+    auto report = [](const char *name, double incomeSeconds, double vacationSeconds, size_t n) {
+        cout << "  " << name << ": income " << (double) n / incomeSeconds << " employees/s, vacation "
+             << (double) n / vacationSeconds << " employees/s" << endl;
+    };
+    for (soa::Kernel kernel : {soa::Kernel::Lookup, soa::Kernel::Simd, soa::Kernel::PerRole}) {
+        if (kernel == soa::Kernel::PerRole)
+            cout << "  groupByRole: " << seconds([&] {table.groupByRole();}) << " s" << endl;
+        else if (kernel == soa::Kernel::Simd && !soa::hasAvx2)
+            continue;
+        soa::IncomeVisitor raise(kernel);
+        soa::VacationVisitor extra(kernel);
+        double incomeSeconds = seconds([&] {table.Accept(&raise);});
+        double vacationSeconds = seconds([&] {table.Accept(&extra);});
+        report(soa::kernelName(kernel), incomeSeconds, vacationSeconds, count);
+    }
+
+    {
+        Employees heap;
+        uint64_t state = 1;
+        for (size_t i = 0; i < virtualCount; i++) {
+            Role role = roleOf(state);
+            switch (role) {
+                case Role::Clerk: heap.Add(new Clerk(baseIncome(role), baseVacation(role))); break;
+                case Role::Director: heap.Add(new Director(baseIncome(role), baseVacation(role))); break;
+                case Role::President: heap.Add(new President(baseIncome(role), baseVacation(role))); break;
+            }
+        }
+        IncomeVisitor raise;
+        VacationVisitor extra;
+        double incomeSeconds = seconds([&] {heap.Accept(&raise);});
+        double vacationSeconds = seconds([&] {heap.Accept(&extra);});
+        cout << virtualCount << " employees as heap objects:" << endl;
+        report("virtual Accept", incomeSeconds, vacationSeconds, virtualCount);
+    }
+}
@@ -0,0 +1,347 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+using namespace std;
+
+//============================================================================
+//Name        : VisitorVariant.cpp
+//
+//VisitorPattern.cpp for a closed set of employee types, without virtual
+//double dispatch:
+//1. Element, ConcreteElement  (closed::Clerk, closed::Director,
+//	 closed::President)
+//	 Plain Employee values with no Accept and no vtable.
+//2. ObjectStructure  (closed::Employees)
+//	 Keeps one contiguous vector<variant<Clerk, Director, President>>;
+//	 the employees live in it, not on the heap. Accept(visitor) calls
+//	 std::visit on each, passing the employee by reference.
+//3. Visitor, ConcreteVisitor  (closed::IncomeVisitor,
+//	 closed::VacationVisitor)
+//	 An overload set: one operator() per employee type, taking it by
+//	 reference, so the raise actually changes the stored employee. The
+//	 compiler checks that every type is covered.
+//
+//The VisitorPattern.cpp classes are repeated for the benchmark. Their
+//Visit(Clerk element) takes a copy of the employee, name string included,
+//and the raise is applied to that copy only.
+//============================================================================
+
+// Counts every operator new, to show what a visit allocates.
+static size_t allocations = 0;
+void *operator new(size_t size) {
+    allocations++;
+    if (void *p = malloc(size == 0 ? 1 : size)) return p;
+    throw bad_alloc();
+}
+void operator delete(void *p) noexcept {free(p);}
+void operator delete(void *p, size_t) noexcept {free(p);}
+
+// When false, visitors print nothing. The benchmark turns it off.
+static bool verbose = true;
+
+//forward declarations:
+class Element;
+class Employee;
+class Clerk;
+class Director;
+class President;
+class Visitor;
+
+// Element  (Element)
+// defines an Accept operation that takes a visitor
+// as an argument.
+class Element{
+public:
+    virtual ~Element() = default;
+    virtual void Accept(Visitor* visitor) = 0;
+};
+
+//ConcreteElement  (Employee)
+//implements an Accept operation that
+//takes a visitor as an argument
+
+class Employee : public Element{
+private:
+    string _name;
+    double _income;
+    int _vacationDays;
+public:
+    //Constructor
+    Employee(string name, double income, int vacationDays){
+        _name = move(name);
+        _income = income;
+        _vacationDays = vacationDays;
+    }
+
+    //Access Functions
+    string getName() {return _name;}
+    void setName(string value) {_name = move(value);}
+    double getIncome() const {return _income;}
+    void setIncome(double value) {_income = value;}
+    int getVacationDays() const {return _vacationDays;}
+    void setVacationDays(int value) {_vacationDays = value;}
+};
+
+//"Visitor"
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+    virtual void Visit(Clerk element) = 0;
+
+    virtual void Visit(Director element) = 0;
+
+    virtual void Visit(President element) = 0;
+};
+
+class Clerk : public Employee {
+public:
+    Clerk(string name, int salary, int vacation) : Employee(move(name), salary, vacation) {}
+    void Accept(Visitor *visitor) final {visitor->Visit(*this);};
+};
+
+class Director : public Employee {
+public:
+    Director(string name, int salary, int vacation) : Employee(move(name), salary, vacation) {}
+    void Accept(Visitor *visitor) final {visitor->Visit(*this);};
+};
+
+class President : public Employee {
+public:
+    President(string name, int salary, int vacation) : Employee(move(name), salary, vacation) {}
+    void Accept(Visitor *visitor) final {visitor->Visit(*this);};
+};
+
+// ObjectStructure  (Employees)
+class Employees{
+public:
+    ~Employees() {for (Employee *employee : employees) delete employee;}
+    void Add(Employee *employee) {employees.push_back(employee);}
+    void Accept(Visitor *visitor){
+        for (auto & employee : employees){
+            employee->Accept(visitor);
+        }
+    }
+    double totalIncome() const {
+        double total = 0;
+        for (Employee *employee : employees) total += employee->getIncome();
+        return total;
+    }
+private:
+    vector<Employee *> employees;
+};
+
+// "ConcreteVisitor 1"
+
+class IncomeVisitor : public Visitor {
+public:
+    void Visit(Clerk element) final {
+        element.setIncome(element.getIncome() * 1.1);
+        if (verbose) cout << element.getName() << "'s new income: " << element.getIncome() << endl;
+    }
+    void Visit(Director element) final {
+        element.setIncome(element.getIncome() * 1.50);
+        if (verbose) cout << element.getName() << "'s new income: " << element.getIncome() << endl;
+    }
+    void Visit(President element) final {
+        element.setIncome(element.getIncome() * 2.0);
+        if (verbose) cout << element.getName() << "'s new income: " << element.getIncome() << endl;
+    }
+};
+
+// "ConcreteVisitor 2"
+
+class VacationVisitor : public Visitor {
+public:
+    void Visit(Clerk element) final {
+        //Provide 3 extra vacation days
+        element.setVacationDays(element.getVacationDays() + 3);
+        if (verbose) cout << element.getName() << "'s new vacation days: " << element.getVacationDays() << endl;
+    }
+
+    void Visit(Director element) final {
+        //Provide 5 extra vacation days
+        element.setVacationDays(element.getVacationDays() + 5);
+        if (verbose) cout << element.getName() << "'s new vacation days: " << element.getVacationDays() << endl;
+    }
+
+    void Visit(President element) final {
+        //Provide 7 extra vacation days
+        element.setVacationDays(element.getVacationDays() + 7);
+        if (verbose) cout << element.getName() << "'s new vacation days: " << element.getVacationDays() << endl;
+    }
+};
+
+namespace closed {
+
+// The same employee data, as a plain value.
+class Employee {
+private:
+    string _name;
+    double _income;
+    int _vacationDays;
+public:
+    Employee(string name, double income, int vacationDays)
+        : _name(move(name)), _income(income), _vacationDays(vacationDays) {}
+
+    //Access Functions
+    const string &getName() const {return _name;}
+    void setName(string value) {_name = move(value);}
+    double getIncome() const {return _income;}
+    void setIncome(double value) {_income = value;}
+    int getVacationDays() const {return _vacationDays;}
+    void setVacationDays(int value) {_vacationDays = value;}
+};
+
+class Clerk : public Employee {using Employee::Employee;};
+class Director : public Employee {using Employee::Employee;};
+class President : public Employee {using Employee::Employee;};
+
+using AnyEmployee = variant<Clerk, Director, President>;
+
+// Turns a list of lambdas into one overload set.
+template <typename... Fs>
+struct overloaded : Fs... {using Fs::operator()...;};
+
+// ObjectStructure  (Employees)
+class Employees{
+public:
+    template <typename T, typename... Args>
+    T &Add(Args &&... args) {return get<T>(employees.emplace_back(in_place_type<T>, forward<Args>(args)...));}
+    void reserve(size_t count) {employees.reserve(count);}
+
+    // visitor needs an operator() for every alternative, taking it by reference.
+    template <typename V>
+    void Accept(V &&visitor) {
+        for (AnyEmployee &employee : employees) visit(visitor, employee);
+    }
+    double totalIncome() const {
+        double total = 0;
+        for (const AnyEmployee &employee : employees)
+            total += visit([](const Employee &e) {return e.getIncome();}, employee);
+        return total;
+    }
+private:
+    vector<AnyEmployee> employees;
+};
+
+// "ConcreteVisitor 1"
+
+class IncomeVisitor {
+public:
+    void operator()(Clerk &element) const {raise(element, 1.1);}
+    void operator()(Director &element) const {raise(element, 1.50);}
+    void operator()(President &element) const {raise(element, 2.0);}
+private:
+    static void raise(Employee &element, double factor) {
+        element.setIncome(element.getIncome() * factor);
+        if (verbose) cout << element.getName() << "'s new income: " << element.getIncome() << endl;
+    }
+};
+
+// "ConcreteVisitor 2", written in place as an overload set of lambdas.
+
+inline auto VacationVisitor() {
+    auto extraDays = [](Employee &element, int days) {
+        element.setVacationDays(element.getVacationDays() + days);
+        if (verbose) cout << element.getName() << "'s new vacation days: " << element.getVacationDays() << endl;
+    };
+    return overloaded{
+        [=](Clerk &element) {extraDays(element, 3);},     //Provide 3 extra vacation days
+        [=](Director &element) {extraDays(element, 5);},  //Provide 5 extra vacation days
+        [=](President &element) {extraDays(element, 7);}, //Provide 7 extra vacation days
+    };
+}
+
+} // namespace closed
+
+template <typename F>
+double seconds(F f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]){
+    //Setup Employee Collection
+    closed::Employees e;
+    e.Add<closed::Clerk>("Ajda Pekkan", 200000, 10);
+    e.Add<closed::Director>("Tarkan", 300000, 20);
+    e.Add<closed::President>("Sertab Erener", 400000, 30);
+
+    //Employees are 'visited'
+    e.Accept(closed::IncomeVisitor());
+    e.Accept(closed::VacationVisitor());
+    cout << "Total income after the raises: " << e.totalIncome() << endl;
+
+    // Benchmark: N employees (default 1M), both visitors R times (default
+    // 5). Names are longer than the small-string buffer, as real ones often
+    // are, so a copied employee allocates.
+    size_t count = argc > 1 ? stoul(argv[1]) : 1000000;
+    int rounds = argc > 2 ? stoi(argv[2]) : 5;
+    verbose = false;
+    auto name = [](size_t i) {return "Employee number " + to_string(i) + " of the company";};
+
+    size_t before = allocations;
+    Employees heap;
+    double heapBuild = seconds([&] {
+        for (size_t i = 0; i < count; i++) {
+            switch (i % 3) {
+                case 0: heap.Add(new Clerk(name(i), 200000, 10)); break;
+                case 1: heap.Add(new Director(name(i), 300000, 20)); break;
+                default: heap.Add(new President(name(i), 400000, 30)); break;
+            }
+        }
+    });
+    size_t heapBuildAllocations = allocations - before;
+
+    before = allocations;
+    closed::Employees contiguous;
+    double contiguousBuild = seconds([&] {
+        contiguous.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            switch (i % 3) {
+                case 0: contiguous.Add<closed::Clerk>(name(i), 200000, 10); break;
+                case 1: contiguous.Add<closed::Director>(name(i), 300000, 20); break;
+                default: contiguous.Add<closed::President>(name(i), 400000, 30); break;
+            }
+        }
+    });
+    size_t contiguousBuildAllocations = allocations - before;
+
+    double heapIncome = heap.totalIncome(), contiguousIncome = contiguous.totalIncome();
+    IncomeVisitor income;
+    VacationVisitor vacation;
+    before = allocations;
+    double heapVisit = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            heap.Accept(&income);
+            heap.Accept(&vacation);
+        }
+    });
+    size_t heapVisitAllocations = allocations - before;
+
+    before = allocations;
+    double contiguousVisit = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            contiguous.Accept(closed::IncomeVisitor());
+            contiguous.Accept(closed::VacationVisitor());
+        }
+    });
+    size_t contiguousVisitAllocations = allocations - before;
+
+    double visits = 2.0 * rounds * (double) count;
+    cout << endl << count << " employees, " << visits << " visits" << endl;
+    cout << "virtual double dispatch, vector<Employee*>:" << endl
+         << "  build " << heapBuild << " s, " << heapBuildAllocations << " allocations" << endl
+         << "  visit " << visits / heapVisit << " visits/s, " << heapVisitAllocations << " allocations"
+         << ", total income " << heapIncome << " -> " << heap.totalIncome() << endl;
+    cout << "std::visit, vector<variant>:" << endl
+         << "  build " << contiguousBuild << " s, " << contiguousBuildAllocations << " allocations" << endl
+         << "  visit " << visits / contiguousVisit << " visits/s, " << contiguousVisitAllocations << " allocations"
+         << ", total income " << contiguousIncome << " -> " << contiguous.totalIncome() << endl;
+}